@@ -0,0 +1,370 @@
+#include "../lib/ArgParse/ArgParse.h"
+#include "../src/algo/sa/sa.h"
+#include "../src/algo/sqa/sqa.h"
+#include "../src/algo/tabu/tabu.h"
+#include "../src/graph/tri/tri.h"
+#include "../src/run.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Annealer benchmarks, one JSON object per line on stdout:
+ *   make bench                              # run everything
+ *   ./bench_exe --quick                     # smaller lattices, fewer sweeps
+ *   ./bench_exe --sample sample/sample.in   # graph used for the file benchmarks
+ */
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince (const Clock::time_point& start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/*
+ * Heap accounting: every allocation of the process goes through these, so the live bytes
+ * held by a graph or an annealer can be measured exactly instead of through RSS pages.
+ */
+std::atomic<long> live_bytes(0), peak_bytes(0), alloc_count(0);
+
+void *countAllocation (void *p) {
+    if (p == nullptr) throw std::bad_alloc();
+    const long live = live_bytes += malloc_usable_size(p);
+    ++alloc_count;
+    long peak = peak_bytes.load();
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live)) {}
+    return p;
+}
+void *operator new (std::size_t size) {
+    return countAllocation(std::malloc(size ? size : 1));
+}
+// The graph arenas (std::pmr) allocate their blocks through the aligned forms
+void *operator new (std::size_t size, std::align_val_t align) {
+    const std::size_t a = std::max<std::size_t>((std::size_t)align, sizeof(void *));
+    return countAllocation(std::aligned_alloc(a, (std::max<std::size_t>(size, 1) + a - 1) / a * a));
+}
+void operator delete (void *p) noexcept {
+    if (p == nullptr) return;
+    live_bytes -= malloc_usable_size(p);
+    std::free(p);
+}
+void operator delete (void *p, std::size_t) noexcept {
+    operator delete(p);
+}
+void operator delete (void *p, std::align_val_t) noexcept {
+    operator delete(p);
+}
+void operator delete (void *p, std::size_t, std::align_val_t) noexcept {
+    operator delete(p);
+}
+
+// Reset the peak to the current live bytes, returns the current live bytes
+long resetPeak () {
+    peak_bytes = live_bytes.load();
+    return live_bytes.load();
+}
+
+// Resident set size of the process, from /proc/self/statm (0 where it is not available)
+long residentBytes () {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+int countEdges (const Graph& graph) {
+    int half_edges = 0;
+    for (auto const& it : graph.getAdjMap())
+        half_edges += it.second.size();
+    return half_edges / 2;
+}
+
+// A single JSON line: { "bench": name, key: value, ... }
+class Report {
+  private:
+    std::ostringstream out;
+
+  public:
+    Report (const std::string& bench) {
+        out << "{\"bench\": \"" << bench << "\"";
+    }
+    Report& add (const std::string& key, const std::string& value) {
+        out << ", \"" << key << "\": \"" << value << "\"";
+        return *this;
+    }
+    Report& add (const std::string& key, const double& value) {
+        out << ", \"" << key << "\": " << value;
+        return *this;
+    }
+    void print () {
+        std::cout << out.str() << "}" << std::endl;
+    }
+};
+
+struct Instance {
+    std::string name;
+    int size; // Lattice length, or 0 for file instances
+    Graph graph; // The annealers copy it, the copies share its couplings
+};
+
+Instance loadSample (const std::string& path, const int& repeat) {
+    Graph graph;
+    double seconds = 0.0;
+    long bytes = 0, allocs = 0;
+    for (int r = 0; r < repeat; ++r) {
+        std::fstream file(path, std::ios::in);
+        const long live_0 = live_bytes.load(), allocs_0 = alloc_count.load();
+        const Clock::time_point start = Clock::now();
+        Graph g                       = readInput(file);
+        seconds += secondsSince(start);
+        bytes  = live_bytes.load() - live_0;
+        allocs = alloc_count.load() - allocs_0;
+        if (r == repeat - 1) graph = g;
+    }
+    graph.lockLength();
+    const int spins = graph.getSpins().size();
+    Report("graph_load")
+        .add("graph", path)
+        .add("spins", spins)
+        .add("edges", countEdges(graph))
+        .add("seconds", seconds / repeat)
+        .add("allocations", allocs)
+        .add("bytes_per_spin", (double)bytes / spins)
+        .add("rss_bytes", residentBytes())
+        .print();
+    return Instance { path, 0, graph };
+}
+
+Instance makeTri (const int& length, const int& repeat) {
+    Graph graph;
+    double seconds = 0.0;
+    long bytes = 0, allocs = 0;
+    for (int r = 0; r < repeat; ++r) {
+        const long live_0 = live_bytes.load(), allocs_0 = alloc_count.load();
+        const Clock::time_point start = Clock::now();
+        Graph g                       = tri::makeGraph(length);
+        seconds += secondsSince(start);
+        bytes  = live_bytes.load() - live_0;
+        allocs = alloc_count.load() - allocs_0;
+        if (r == repeat - 1) graph = g;
+    }
+    graph.lockLength(length * length);
+    const int spins = graph.getSpins().size();
+    Report("graph_make")
+        .add("graph", "tri")
+        .add("size", length)
+        .add("spins", spins)
+        .add("edges", countEdges(graph))
+        .add("seconds", seconds / repeat)
+        .add("allocations", allocs)
+        .add("bytes_per_spin", (double)bytes / spins)
+        .add("rss_bytes", residentBytes())
+        .print();
+    return Instance { "tri", length, graph };
+}
+
+// A lattice with its spins shuffled, as an encoder with arbitrary indices would write it, and the
+// same shuffle relabeled as --reorder rcm does. The sweeps compare the cost of scattered labels.
+Instance makeShuffled (const int& length, const bool& reorder) {
+    Graph g = tri::makeGraph(length);
+    g.lockLength(length * length);
+    std::vector<int> order(length * length);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    g = g.permute(order);
+    if (reorder) {
+        order = g.getOrdering(true);
+        std::reverse(order.begin(), order.end());
+        g = g.permute(order);
+    }
+    return Instance { reorder ? "tri_rcm" : "tri_shuffled", length, g };
+}
+
+void benchDifference (Instance& inst, const int& repeat) {
+    const int spins = inst.graph.getSpins().size();
+    double checksum = 0.0;
+
+    const Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; ++r)
+        for (int i = 0; i < spins; ++i)
+            checksum += inst.graph.getHamiltonianDifference(i);
+    const double seconds = secondsSince(start);
+
+    Report("hamiltonian_difference")
+        .add("graph", inst.name)
+        .add("size", inst.size)
+        .add("spins", spins)
+        .add("calls", (double)spins * repeat)
+        .add("ns_per_call", seconds * 1e9 / ((double)spins * repeat))
+        .add("checksum", checksum)
+        .print();
+}
+
+void benchEnergy (Instance& inst, const int& repeat) {
+    const int spins = inst.graph.getSpins().size();
+    double checksum = 0.0;
+
+    const Clock::time_point start = Clock::now();
+    for (int r = 0; r < repeat; ++r)
+        checksum += inst.graph.getHamiltonianEnergy();
+    const double seconds = secondsSince(start);
+
+    Report("hamiltonian_energy")
+        .add("graph", inst.name)
+        .add("size", inst.size)
+        .add("spins", spins)
+        .add("ns_per_call", seconds * 1e9 / repeat)
+        .add("ns_per_spin", seconds * 1e9 / ((double)spins * repeat))
+        .add("checksum", checksum)
+        .print();
+}
+
+// Time of an anneal with tau + 1 sweeps, including the annealer construction
+template <typename A, typename P>
+double timeAnneal (const Graph& graph, P params, const int& tau, double& energy) {
+    params.tau                    = tau;
+    const Clock::time_point start = Clock::now();
+    A anlr(graph, params);
+    anlr.setSeed(1);
+    energy = anlr.anneal();
+    return secondsSince(start);
+}
+
+// Per sweep cost from the difference of a long and a single sweep anneal, so construction
+// and layer growth are excluded
+template <typename A, typename P>
+void benchSweeps (const std::string& bench, Instance& inst, const P& params, const int& sweeps,
+                  const int& layers) {
+    double energy          = 0.0;
+    const double t_one     = timeAnneal<A>(inst.graph, params, 0, energy);
+    const long live_0      = resetPeak();
+    const double t_all     = timeAnneal<A>(inst.graph, params, sweeps, energy);
+    const double per_sweep = (t_all - t_one) / sweeps;
+    const double proposals = (double)inst.graph.getSpins().size() * layers;
+
+    Report(bench)
+        .add("graph", inst.name)
+        .add("size", inst.size)
+        .add("spins", proposals)
+        .add("sweeps", sweeps + 1)
+        .add("seconds", t_all)
+        .add("ns_per_proposal", per_sweep * 1e9 / proposals)
+        .add("proposals_per_sec", proposals / per_sweep)
+        .add("bytes_per_spin", (double)(peak_bytes.load() - live_0) / proposals)
+        .add("energy", energy)
+        .print();
+}
+
+// Repeated SQA runs in one process, as --ans-count does: the layers grown by every run are
+// freed with its graph, so the live heap returns to where it started and RSS stays flat
+void benchTeardown (Instance& inst, const int& rounds, const int& layers) {
+    const int spins = inst.graph.getSpins().size();
+    Params_SQA params;
+    params.layer_count = layers;
+    params.tau         = 0;
+    const long live_0  = live_bytes.load(), allocs_0 = alloc_count.load();
+    long rss_first     = 0;
+    for (int r = 0; r < rounds; ++r) {
+        {
+            Anlr_SQA anlr(inst.graph, params);
+            anlr.setSeed(1);
+            anlr.anneal();
+        }
+        if (r == 0) rss_first = residentBytes();
+    }
+    const long live = live_bytes.load() - live_0, allocs = alloc_count.load() - allocs_0;
+    const long rss  = residentBytes();
+
+    Report("sqa_teardown")
+        .add("graph", inst.name)
+        .add("size", inst.size)
+        .add("spins", (double)spins * layers)
+        .add("rounds", rounds)
+        .add("allocations_per_round", (double)allocs / rounds)
+        .add("live_bytes_after", live)
+        .add("rss_bytes", rss)
+        .add("rss_growth_bytes", rss - rss_first)
+        .print();
+}
+
+// Cost of a replica: every annealer of a replica run copies the graph it anneals
+void benchReplicas (Instance& inst, const int& count) {
+    const int spins = inst.graph.getSpins().size();
+    Params_SA params;
+    std::vector<Anlr_SA> replicas;
+    replicas.reserve(count);
+
+    const long live_0             = live_bytes.load(), allocs_0 = alloc_count.load();
+    const Clock::time_point start = Clock::now();
+    for (int r = 0; r < count; ++r)
+        replicas.emplace_back(inst.graph, params);
+    const double seconds = secondsSince(start);
+
+    Report("replica_create")
+        .add("graph", inst.name)
+        .add("size", inst.size)
+        .add("spins", spins)
+        .add("replicas", count)
+        .add("ns_per_replica", seconds * 1e9 / count)
+        .add("allocations_per_replica", (double)(alloc_count.load() - allocs_0) / count)
+        .add("bytes_per_replica", (double)(live_bytes.load() - live_0) / count)
+        .print();
+}
+
+int main (int argc, char **argv) {
+    using namespace argparse;
+    Args args(argc, argv,
+              std::vector<ArgFormat>({
+                  { "--sample", ARG_STRING, 1 }, // Graph file for the file benchmarks
+                  { "--quick", ARG_BOOL, 0 },    // Smaller lattices, fewer sweeps
+              }));
+    const bool quick        = args.hasArg("--quick");
+    const std::string path  = args.hasArg("--sample")
+                                  ? std::get<std::string>(args.getArg("--sample"))
+                                  : std::string("sample/sample.in");
+    const std::vector<int> sizes = quick ? std::vector<int>({ 12, 24 })
+                                         : std::vector<int>({ 16, 32, 64, 128 });
+    const int repeat = quick ? 2 : 10, sweeps = quick ? 20 : 200, layers = 8;
+
+    std::cout.precision(6);
+
+    std::vector<Instance> instances;
+    if (access(path.c_str(), R_OK) == 0) instances.push_back(loadSample(path, repeat));
+    else std::cerr << "Skipping " << path << ": not readable" << std::endl;
+    for (const int& length : sizes)
+        instances.push_back(makeTri(length, repeat));
+    instances.push_back(makeShuffled(sizes.back(), false));
+    instances.push_back(makeShuffled(sizes.back(), true));
+
+    for (Instance& inst : instances) {
+        benchDifference(inst, repeat * 10);
+        benchEnergy(inst, repeat * 10);
+        benchReplicas(inst, repeat * 10);
+        benchTeardown(inst, repeat, layers);
+
+        Params_SA sa_params;
+        benchSweeps<Anlr_SA>("sa_sweep", inst, sa_params, sweeps, 1);
+
+        Params_SQA sqa_params;
+        sqa_params.layer_count = layers;
+        benchSweeps<Anlr_SQA>("sqa_sweep", inst, sqa_params, sweeps, layers);
+
+        // A tabu move costs O(degree log spins), a step O(spins degree log spins)
+        Params_TABU tabu_params;
+        benchSweeps<Anlr_TABU>("tabu_step", inst, tabu_params, sweeps, 1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,481 @@
+#include "../src/algo/sa/sa.h"
+#include "../src/algo/sqa/sqa.h"
+#include "../src/algo/tabu/tabu.h"
+#include "../src/algo/wl/wl.h"
+#include "../src/graph/Graph.h"
+#include "../src/graph/IdMap.h"
+#include "../src/graph/preprocess/preprocess.h"
+#include "../src/run.h"
+#include "../src/serve/serve.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Behavioural checks against brute force on graphs of at most 16 spins, deterministic (fixed
+ * seeds) and quick:
+ *   make check      # build check_exe and run every check
+ * Every check prints "ok <name>" or "FAIL <name>: <why>", the exit status is the failure count.
+ */
+
+const double TOLERANCE = 1e-9;
+
+int failures = 0;
+
+void expect (const bool& ok, const std::string& name, const std::string& why) {
+    if (ok) {
+        std::cout << "ok " << name << std::endl;
+        return;
+    }
+    std::cout << "FAIL " << name << ": " << why << std::endl;
+    ++failures;
+}
+
+// Read text as an input file, through the same readInput as the command line
+Graph loadText (const std::string& text, const bool& qubo, IdMap& ids) {
+    const std::string path = "check_input.tmp";
+    std::ofstream(path) << text;
+    std::fstream source(path, std::ios::in);
+    Graph graph = qubo ? readInputFromQubo(source, ids) : readInput(source, ids);
+    source.close();
+    std::remove(path.c_str());
+    return graph;
+}
+Graph loadText (const std::string& text, const bool& qubo) {
+    IdMap ids;
+    return loadText(text, qubo, ids);
+}
+
+// Random couplings, fields and self loops on n spins, weights in [-range, range]
+Graph randomGraph (const int& n, const int& range, const unsigned int& seed) {
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> weight(-range, range);
+    std::bernoulli_distribution edge(0.5);
+    Graph graph;
+    for (int i = 0; i < n; ++i) {
+        graph.pushBack(i, weight(generator));
+        if (edge(generator)) graph.pushBack(i, i, weight(generator)); // Self loop
+        for (int j = i + 1; j < n; ++j)
+            if (edge(generator)) graph.pushBack(i, j, weight(generator));
+    }
+    graph.pushBack(weight(generator));
+    return graph;
+}
+
+// Energy of every configuration, bit i of the index is spin i (1 for UP)
+std::vector<double> enumerate (Graph graph) {
+    const int n = graph.getSpins().size();
+    std::vector<double> energies(1 << n);
+    for (int mask = 0; mask < (1 << n); ++mask) {
+        for (int i = 0; i < n; ++i)
+            graph.setSpin(i, (mask >> i & 1) ? 1 : -1);
+        energies[mask] = graph.getHamiltonianEnergy();
+    }
+    return energies;
+}
+
+// Configuration of a mask of enumerate
+std::vector<Spin> configOf (const int& mask, const int& n) {
+    std::vector<Spin> spins(n);
+    for (int i = 0; i < n; ++i)
+        spins[i] = (mask >> i & 1) ? UP : DOWN;
+    return spins;
+}
+
+double energyOf (Graph graph, const std::vector<Spin>& spins) {
+    for (size_t i = 0; i < spins.size(); ++i)
+        graph.setSpin(i, (int)spins[i]);
+    return graph.getHamiltonianEnergy();
+}
+
+// A scripted client of --serve, request lines out and reply lines in
+class StubClient {
+  private:
+    int fd = -1;
+    std::string pending;
+
+  public:
+    StubClient (const std::string& path) {
+        sockaddr_un address = {};
+        address.sun_family  = AF_UNIX;
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        for (int attempt = 0; attempt < 100; ++attempt) { // The server may not listen yet
+            this->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (connect(this->fd, (sockaddr *)&address, sizeof(address)) == 0) return;
+            close(this->fd);
+            this->fd = -1;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+    ~StubClient () {
+        if (this->fd >= 0) close(this->fd);
+    }
+
+    bool connected () const {
+        return this->fd >= 0;
+    }
+    void send (const std::string& line) {
+        const std::string data = line + "\n"; // A failed write shows up as a missing reply
+        ::send(this->fd, data.data(), data.size(), MSG_NOSIGNAL);
+    }
+    // The next reply line, empty once the server closes or is silent for 10 seconds
+    std::string next () {
+        while (true) {
+            const size_t end = this->pending.find('\n');
+            if (end != std::string::npos) {
+                const std::string line = this->pending.substr(0, end);
+                this->pending.erase(0, end + 1);
+                return line;
+            }
+            pollfd watched = { this->fd, POLLIN, 0 };
+            char buffer[4096];
+            if (poll(&watched, 1, 10000) <= 0) return "";
+            const ssize_t n = recv(this->fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) return "";
+            this->pending.append(buffer, n);
+        }
+    }
+};
+
+/* Checks */
+
+// The flip delta of every spin of every configuration is the energy difference
+void checkDifference () {
+    Graph graph  = randomGraph(8, 5, 1);
+    const int n  = graph.getSpins().size();
+    double worst = 0.0;
+    for (int mask = 0; mask < (1 << n); ++mask) {
+        for (int i = 0; i < n; ++i)
+            graph.setSpin(i, (mask >> i & 1) ? 1 : -1);
+        const double before = graph.getHamiltonianEnergy();
+        for (int i = 0; i < n; ++i) {
+            const double delta = graph.getHamiltonianDifference(i);
+            graph.flipSpin(i);
+            worst = std::max(worst, std::fabs(graph.getHamiltonianEnergy() - before - delta));
+            graph.flipSpin(i);
+        }
+    }
+    std::ostringstream why;
+    why << "largest error " << worst;
+    expect(worst < TOLERANCE, "hamiltonian_difference", why.str());
+}
+
+// A QUBO with diagonal terms (self loops) never reaches an energy below its minimum
+void checkSelfLoopTarget () {
+    const Graph graph                  = loadText("0 0 10\n1 1 10\n0 1 1\n", true);
+    const std::vector<double> energies = enumerate(graph);
+    const double minimum               = *std::min_element(energies.begin(), energies.end());
+
+    Params_SA params;
+    params.init_t  = 100.0;
+    params.final_t = 50.0;
+    params.tau     = 1000;
+    Anlr_SA annealer(graph, params);
+    annealer.setSeed(1);
+    StopPolicy stop;
+    stop.has_target    = true;
+    stop.target_energy = -100.0;
+    annealer.setStop(stop);
+    annealer.anneal();
+
+    std::ostringstream why;
+    why << "best " << annealer.getBestEnergy() << " below the minimum " << minimum;
+    expect(annealer.getBestEnergy() >= minimum - TOLERANCE, "sa_self_loop_energy", why.str());
+}
+
+// SA ends on the best configuration it tracked, at a temperature where the last one is not it
+void checkBestRestore () {
+    const Graph graph = randomGraph(12, 5, 2);
+    std::ostringstream why;
+    bool ok = true;
+    for (unsigned int seed = 1; seed <= 8; ++seed) {
+        Params_SA params;
+        params.init_t  = 8.0;
+        params.final_t = 4.0;
+        params.tau     = 200;
+        Anlr_SA annealer(graph, params);
+        annealer.setSeed(seed);
+        const double restored = annealer.anneal();
+        if (std::fabs(restored - annealer.getBestEnergy()) < TOLERANCE) continue;
+        why << "seed " << seed << " restored " << restored << " tracked "
+            << annealer.getBestEnergy() << " ";
+        ok = false;
+    }
+    expect(ok, "sa_best_restore", why.str());
+}
+
+// SQA with self loops in the graph: every Trotter layer carries them, so the best layer is the
+// lowest classical energy, never below the minimum, and it is the energy of the returned spins
+void checkSQA () {
+    std::ostringstream why;
+    bool ok = true;
+    for (unsigned int seed = 0; seed <= 4; ++seed) {
+        Graph graph = seed == 0 ? loadText("0 0 10\n1 1 10\n0 1 1\n", true)
+                                : randomGraph(8, 5, 40 + seed);
+        graph.lockLength();
+        const std::vector<double> energies = enumerate(graph);
+        const double minimum               = *std::min_element(energies.begin(), energies.end());
+        Params_SQA params;
+        params.tau         = 200;
+        params.layer_count = 4;
+        Anlr_SQA annealer(graph, params);
+        annealer.setSeed(seed + 1);
+        const double energy   = annealer.anneal();
+        const double returned = energyOf(graph, annealer.getBestSpins());
+        if (energy >= minimum - TOLERANCE && std::fabs(returned - energy) < TOLERANCE) continue;
+        why << "graph " << seed << " best layer " << energy << " returned spins " << returned
+            << " minimum " << minimum << " ";
+        ok = false;
+    }
+    expect(ok, "sqa_layer_energy", why.str());
+}
+
+// A --serve session of a stub client: load, solve with sa and sqa (queued, then result lines,
+// then done with the energy of the spins it lists), cancel a long job, shutdown
+void checkServe () {
+    const std::string socket_path = "check_serve.sock", input = "check_input.tmp";
+    const std::string text        = "0 0 10\n1 1 10\n0 1 1\n";
+    IdMap ids;
+    const Graph graph                  = loadText(text, true, ids);
+    const std::vector<double> energies = enumerate(graph);
+    const double minimum               = *std::min_element(energies.begin(), energies.end());
+    std::ofstream(input) << text;
+
+    const char *argv[] = { "check_exe", "--serve", socket_path.c_str(), "--workers", "1" };
+    CustomArgs args(5, (char **)argv);
+    std::thread server([&args] () {
+        try {
+            serve::run(args);
+        } catch (const std::exception& e) {
+            std::cout << "serve: " << e.what() << std::endl;
+        }
+    });
+    std::ostringstream why;
+    bool ok = true;
+    {
+        StubClient client(socket_path);
+        std::string reply, word, instance;
+        int spins = 0;
+        client.send("load " + input + " qubo");
+        std::istringstream(reply = client.next()) >> word >> instance >> spins;
+        if (word != "ok" || spins != (int)graph.getSpins().size()) {
+            why << "load replied \"" << reply << "\" ";
+            ok = false;
+        }
+        for (const std::string& engine : { std::string("sa"), std::string("sqa layers=4") }) {
+            client.send("solve " + instance + " " + engine + " tau=200 seed=1");
+            long job = 0;
+            std::istringstream(reply = client.next()) >> word >> job;
+            if (word != "queued") {
+                why << engine << " replied \"" << reply << "\" before queued ";
+                ok = false;
+                continue;
+            }
+            const std::string prefix = "done " + std::to_string(job) + " ";
+            bool result              = false; // A replica reported before done
+            while (!(reply = client.next()).empty() && reply.rfind(prefix, 0) != 0)
+                result |= reply.rfind("result " + std::to_string(job) + " ", 0) == 0;
+            std::istringstream done(reply.substr(std::min(reply.size(), prefix.size())));
+            double energy = DBL_MAX;
+            done >> word >> energy;
+            std::vector<Spin> config(ids.size(), UP);
+            for (int64_t id, spin; done >> id >> spin;)
+                config[ids.index(id)] = spin > 0 ? UP : DOWN;
+            const double listed = energyOf(graph, config);
+            if (word == "ok" && result && std::fabs(energy - listed) < TOLERANCE &&
+                energy >= minimum - TOLERANCE)
+                continue;
+            why << engine << " done \"" << reply << "\" spins " << listed << " minimum " << minimum
+                << (result ? " " : " without a result line ");
+            ok = false;
+        }
+        client.send("solve " + instance + " sa tau=100000000");
+        long job = 0;
+        std::istringstream(reply = client.next()) >> word >> job;
+        client.send("cancel " + std::to_string(job));
+        bool answered = false, cancelled = false;
+        while ((!answered || !cancelled) && !(reply = client.next()).empty()) {
+            answered |= reply == "ok"; // Either comes first when the job was already running
+            cancelled |= reply.rfind("done " + std::to_string(job) + " cancelled", 0) == 0;
+        }
+        if (word != "queued" || !answered || !cancelled) {
+            why << "cancel of job " << job << " not answered with ok and done cancelled ";
+            ok = false;
+        }
+        client.send("shutdown");
+        if ((reply = client.next()) != "ok") {
+            why << "shutdown replied \"" << reply << "\" ";
+            ok = false;
+        }
+    }
+    server.join();
+    std::remove(input.c_str());
+    expect(ok, "serve_session", why.str());
+}
+
+// Tabu search reaches the ground state of small graphs, and its result is the energy it reports
+void checkTabu () {
+    std::ostringstream why;
+    bool ok = true;
+    for (unsigned int seed = 1; seed <= 4; ++seed) {
+        const Graph graph                  = randomGraph(14, 5, 10 + seed);
+        const std::vector<double> energies = enumerate(graph);
+        const double minimum               = *std::min_element(energies.begin(), energies.end());
+        Params_TABU params;
+        params.tau    = 50;
+        params.starts = 2;
+        Anlr_TABU annealer(graph, params);
+        annealer.setSeed(seed);
+        const double energy = annealer.anneal();
+        if (std::fabs(energy - minimum) < TOLERANCE
+            && std::fabs(annealer.getHamiltonianEnergy() - energy) < TOLERANCE)
+            continue;
+        why << "graph " << seed << " found " << energy << " minimum " << minimum << " ";
+        ok = false;
+    }
+    expect(ok, "tabu_ground_state", why.str());
+}
+
+// Wang-Landau ln g of every energy of an integer graph, one and two windows, against the counts
+void checkWangLandau () {
+    const Graph graph = randomGraph(10, 2, 20);
+    std::map<long, double> exact;
+    for (const double& e : enumerate(graph))
+        exact[std::lround(e)] += 1.0;
+    for (const int& windows : { 1, 2 }) {
+        Params_WL params;
+        params.windows   = windows;
+        params.final_lnf = 1e-5;
+        Anlr_WL annealer(graph, params);
+        annealer.setSeed(1);
+        annealer.anneal();
+        const std::vector<DensityPoint> density = annealer.getDensity();
+        double worst = density.size() == exact.size() ? 0.0 : DBL_MAX;
+        for (const DensityPoint& p : density) {
+            std::map<long, double>::const_iterator it = exact.find(std::lround(p.energy));
+            if (it == exact.end()) worst = DBL_MAX;
+            else worst = std::max(worst, std::fabs(p.ln_g - std::log(it->second)));
+        }
+        std::ostringstream why;
+        why << density.size() << " energies of " << exact.size() << ", largest ln g error "
+            << worst;
+        expect(worst < 0.05, "wl_density_w" + std::to_string(windows), why.str());
+    }
+}
+
+// Preprocess keeps a ground state: the fixed spins with a ground state of every component are a
+// ground state of the graph, and the offset with the component minima is the minimum
+void checkPreprocess () {
+    std::ostringstream why;
+    bool ok   = true;
+    int fixed = 0;
+    for (unsigned int seed = 1; seed <= 6; ++seed) {
+        Graph graph = randomGraph(12, 2, 30 + seed);
+        for (int i = 0; i < 12; i += 3)
+            graph.pushBack(i, (i / 3) % 2 ? 8.0 : -8.0); // Strong enough to dominate
+        const std::vector<double> energies = enumerate(graph);
+        const double minimum               = *std::min_element(energies.begin(), energies.end());
+
+        const preprocess::Reduction r = preprocess::reduce(graph);
+        fixed += r.dominance + r.persistency;
+        std::vector<std::vector<Spin> > configs;
+        double total = r.offset;
+        for (size_t c = 0; c < r.graphs.size(); ++c) {
+            const int n = r.components[c].size();
+            if ((int)r.graphs[c].getSpins().size() != n) {
+                why << "graph " << seed << " component " << c << " lost spins";
+                return expect(false, "preprocess_ground_state", why.str());
+            }
+            const std::vector<double> local = enumerate(r.graphs[c]);
+            const int best = std::min_element(local.begin(), local.end()) - local.begin();
+            configs.push_back(configOf(best, n));
+            total += local[best];
+        }
+        const double expanded = energyOf(graph, preprocess::expand(r, configs));
+        if (std::fabs(expanded - minimum) < TOLERANCE && std::fabs(total - minimum) < TOLERANCE)
+            continue;
+        why << "graph " << seed << " expanded " << expanded << " offset and minima " << total
+            << " minimum " << minimum << " ";
+        ok = false;
+    }
+    if (fixed == 0) {
+        why << "no spin was fixed";
+        ok = false;
+    }
+    expect(ok, "preprocess_ground_state", why.str());
+}
+
+// IdMap maps sparse IDs (negative, 64-bit, repeated) to 0..N-1 in increasing order and back, and
+// a file with such IDs loads as the same graph as its densely numbered copy
+void checkIdMap () {
+    std::ostringstream why;
+    bool ok = true;
+    const std::vector<int64_t> seen = { 40, -7, 3000000000000LL, 40, 5, -7, 12 };
+    const IdMap ids(seen);
+    const std::vector<int64_t> sorted = { -7, 5, 12, 40, 3000000000000LL };
+    if (ids.getIds() != sorted) {
+        why << "IDs not sorted and unique ";
+        ok = false;
+    }
+    for (int i = 0; i < ids.size(); ++i)
+        if (ids.index(ids.id(i)) != i) {
+            why << "index " << i << " does not round trip ";
+            ok = false;
+        }
+    if (ids.index(6) != -1 || ids.index(0) != -1) {
+        why << "an unknown ID has an index ";
+        ok = false;
+    }
+    const IdMap dense(std::vector<int64_t>({ 2, 0, 1, 2 }));
+    for (int i = 0; i < 3; ++i)
+        if (dense.index(i) != i || dense.id(i) != i) {
+            why << "dense ID " << i << " moved ";
+            ok = false;
+        }
+    if (dense.index(3) != -1 || dense.index(-1) != -1) {
+        why << "an ID out of the dense range has an index ";
+        ok = false;
+    }
+
+    IdMap loaded;
+    const Graph sparse =
+        loadText("40 -7 1.5\n-7 12 -2\n12 40 1\n3000000000000 2.5\n", false, loaded);
+    const Graph relabeled = loadText("2 0 1.5\n0 1 -2\n1 2 1\n3 2.5\n", false);
+    const std::vector<double> a = enumerate(sparse), b = enumerate(relabeled);
+    if (loaded.getIds() != std::vector<int64_t>({ -7, 12, 40, 3000000000000LL }) || a != b) {
+        why << "the sparse file does not load as its dense copy";
+        ok = false;
+    }
+    expect(ok, "id_map_round_trip", why.str());
+}
+
+int main () {
+    checkDifference();
+    checkSelfLoopTarget();
+    checkBestRestore();
+    checkSQA();
+    checkTabu();
+    checkPreprocess();
+    checkIdMap();
+    checkServe();
+    checkWangLandau();
+    std::cout << (failures == 0 ? "all checks passed" : "checks failed") << std::endl;
+    return failures;
+}
@@ -0,0 +1,118 @@
+#include "anneal.h"
+
+#include <math.h>
+#include <stdio.h>
+
+/*
+ * Round trip of the C interface, built as C against build/libanneal.so so the exported symbols
+ * are the ones of the version script:
+ *   make check      # also builds and runs check_api_exe
+ * Every engine solves a small graph with self loops and fields, the energy of every result must
+ * be the energy anneal_graph_energy gives its spins, and never below the brute-force minimum.
+ * Prints "ok <name>" or "FAIL <name>: <why>", the exit status is the failure count.
+ */
+
+#define SPINS 8
+#define TOLERANCE 1e-9
+
+static int failures = 0;
+
+static void expect (const int ok, const char *name, const char *why) {
+    if (ok) {
+        printf("ok %s\n", name);
+        return;
+    }
+    printf("FAIL %s: %s\n", name, why);
+    ++failures;
+}
+
+// A ring with a chord, a field on every spin, two self loops and a constant
+static anneal_graph *buildGraph (void) {
+    int i[SPINS + 3], j[SPINS + 3], index[SPINS];
+    double weight[SPINS + 3], field[SPINS];
+    for (int k = 0; k < SPINS; ++k) {
+        i[k]      = k;
+        j[k]      = (k + 1) % SPINS;
+        weight[k] = (k % 3) - 1.5;
+        index[k]  = k;
+        field[k]  = (k % 2) ? 0.5 : -0.25;
+    }
+    const int extra[3][2]   = { { 0, 4 }, { 2, 2 }, { 5, 5 } }; // A chord and two self loops
+    const double extra_w[3] = { 2.0, 3.0, -1.0 };
+    for (int k = 0; k < 3; ++k) {
+        i[SPINS + k]      = extra[k][0];
+        j[SPINS + k]      = extra[k][1];
+        weight[SPINS + k] = extra_w[k];
+    }
+    anneal_graph *graph = anneal_graph_create(SPINS);
+    if (graph == NULL || anneal_graph_add_couplings(graph, SPINS + 3, i, j, weight) != ANNEAL_OK
+        || anneal_graph_add_fields(graph, SPINS, index, field) != ANNEAL_OK
+        || anneal_graph_add_constant(graph, 1.25) != ANNEAL_OK) {
+        anneal_graph_destroy(graph);
+        return NULL;
+    }
+    return graph;
+}
+
+// Lowest energy of every configuration, bit k of the mask is spin k (1 for +1)
+static double minimum (const anneal_graph *graph) {
+    double lowest = INFINITY;
+    int8_t spins[SPINS];
+    for (int mask = 0; mask < (1 << SPINS); ++mask) {
+        double energy;
+        for (int k = 0; k < SPINS; ++k)
+            spins[k] = (mask >> k & 1) ? 1 : -1;
+        if (anneal_graph_energy(graph, spins, SPINS, &energy) == ANNEAL_OK && energy < lowest)
+            lowest = energy;
+    }
+    return lowest;
+}
+
+// Solve with an engine and compare every result with the energy of its spins
+static void checkEngine (const anneal_graph *graph, const double lowest, const int engine,
+                         const char *name) {
+    char why[256]         = "";
+    int ok                = 1;
+    anneal_solver *solver = anneal_solver_create(engine);
+    if (solver == NULL || anneal_solver_set_int(solver, "tau", 200) != ANNEAL_OK
+        || anneal_solver_set_int(solver, "seed", 1) != ANNEAL_OK
+        || anneal_solver_set_int(solver, "replicas", 2) != ANNEAL_OK
+        || anneal_solve(solver, graph) != ANNEAL_OK || anneal_result_count(solver) != 2) {
+        snprintf(why, sizeof(why), "solve failed: %s", anneal_last_error());
+        anneal_solver_destroy(solver);
+        expect(0, name, why);
+        return;
+    }
+    for (int r = 0; r < anneal_result_count(solver) && ok; ++r) {
+        double reported, energy;
+        int8_t spins[SPINS];
+        if (anneal_result_energy(solver, r, &reported) != ANNEAL_OK
+            || anneal_result_spins(solver, r, spins, SPINS) != ANNEAL_OK
+            || anneal_graph_energy(graph, spins, SPINS, &energy) != ANNEAL_OK) {
+            snprintf(why, sizeof(why), "result %d: %s", r, anneal_last_error());
+            ok = 0;
+        } else if (fabs(reported - energy) > TOLERANCE || reported < lowest - TOLERANCE) {
+            snprintf(why, sizeof(why), "result %d reported %g, its spins %g, minimum %g", r,
+                     reported, energy, lowest);
+            ok = 0;
+        }
+    }
+    anneal_solver_destroy(solver);
+    expect(ok, name, why);
+}
+
+int main (void) {
+    anneal_graph *graph = buildGraph();
+    if (graph == NULL) {
+        printf("FAIL api_graph: %s\n", anneal_last_error());
+        return 1;
+    }
+    const double lowest = minimum(graph);
+    checkEngine(graph, lowest, ANNEAL_SA, "api_sa");
+    checkEngine(graph, lowest, ANNEAL_SQA, "api_sqa");
+    checkEngine(graph, lowest, ANNEAL_TABU, "api_tabu");
+    checkEngine(graph, lowest, ANNEAL_PA, "api_pa");
+    anneal_graph_destroy(graph);
+    printf("%s\n", failures == 0 ? "all api checks passed" : "api checks failed");
+    return failures;
+}
@@ -0,0 +1,211 @@
+#include "cluster.h"
+#include "../../include/Parallel.h"
+#include "../../profile/Profile.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
+namespace cluster {
+
+// Sites per labeling block. The bonds of a block are drawn from its own generator, so the
+// clusters do not depend on the thread count.
+static const int BLOCK_SITES = 4096;
+
+Kind fromName (const std::string& name) {
+    if (name == "sw") return SWENDSEN_WANG;
+    if (name == "wolff") return WOLFF;
+    if (name == "kbd") return KBD;
+    throw std::invalid_argument("Unknown cluster move " + name + ", expected sw, wolff or kbd");
+}
+
+// UnionFind
+UnionFind::UnionFind (const int& size) : parent(size) {
+    for (int i = 0; i < size; ++i)
+        this->parent[i] = i;
+    return;
+}
+
+int UnionFind::find (const int& index) {
+    int i = index;
+    while (this->parent[i] != i) {
+        this->parent[i] = this->parent[this->parent[i]];
+        i               = this->parent[i];
+    }
+    return i;
+}
+
+int UnionFind::root (const int& index) const {
+    int i = index;
+    while (this->parent[i] != i)
+        i = this->parent[i];
+    return i;
+}
+
+void UnionFind::unite (const int& a, const int& b) {
+    const int root_a = this->find(a), root_b = this->find(b);
+    if (root_a == root_b) return;
+    // The lower index is the root, so a block only ever links its own sites
+    if (root_a < root_b) this->parent[root_b] = root_a;
+    else this->parent[root_a] = root_b;
+    return;
+}
+
+// Probability of freezing a satisfied bond of weight w
+static double freezeProbability (const double& w, const double& T) {
+    return T > 0.0 ? 1.0 - std::exp(-2.0 * std::fabs(w) / T) : 1.0;
+}
+
+// Field energy sum h s, the cluster changes the energy by -2 of it when flipped
+static double fieldOf (const Couplings& c, const std::vector<Spin>& spins, const int& index) {
+    std::map<int, double>::const_iterator it = c.fields.find(index);
+    return it == c.fields.end() ? 0.0 : it->second * (double)spins[index];
+}
+
+// Heat bath probability of flipping a cluster that changes the energy by delta_E
+static double flipProbability (const double& delta_E, const double& T) {
+    if (T <= 0.0) return delta_E < 0.0 ? 1.0 : (delta_E > 0.0 ? 0.0 : 0.5);
+    return 1.0 / (1.0 + std::exp(delta_E / T));
+}
+
+// Freeze the bonds of the sites [begin, end): link(i, j) is called for every frozen bond
+template <typename Link>
+static void freezeBonds (const Couplings& c, const std::vector<Spin>& spins, const Kind& kind,
+                         const double& T, const int& begin, const int& end, std::mt19937& random,
+                         Link link) {
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    if (kind == KBD) {
+        const int length = c.tri_length;
+        for (int i = begin; i < end; ++i) {
+            const int row = i / length, col = i % length;
+            const int right  = row * length + (col + 1) % length;
+            const int corner = ((row + 1) % length) * length + (col + 1) % length;
+            if (spins[i] == spins[right] && spins[right] == spins[corner]) continue; // Excited
+            double J = 0.0;
+            for (AdjNode *tmp = c.adj_list[i]; tmp != nullptr; tmp = tmp->next)
+                if (tmp->val == right) J += tmp->weight;
+            const double p = T > 0.0 ? 1.0 - std::exp(-4.0 * J / T) : 1.0;
+            // The two satisfied bonds join all three sites
+            if (dis(random) < p) {
+                link(i, right);
+                link(i, corner);
+            }
+        }
+        return;
+    }
+    for (int i = begin; i < end && i < (int)c.adj_list.size(); ++i)
+        for (AdjNode *tmp = c.adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+            const int j = tmp->val;
+            if (j <= i || tmp->weight * (double)spins[i] * (double)spins[j] >= 0.0) continue;
+            if (dis(random) < freezeProbability(tmp->weight, T)) link(i, j);
+        }
+    return;
+}
+
+long multiCluster (const Couplings& c, std::vector<Spin>& spins, const Kind& kind, const double& T,
+                   const int& threads, std::mt19937& generator) {
+    if (kind == KBD && (long)c.tri_length * c.tri_length != (long)spins.size())
+        throw std::invalid_argument("KBD cluster moves need the --h-tri lattice");
+    const int length = spins.size();
+    const int blocks = (length + BLOCK_SITES - 1) / BLOCK_SITES;
+    std::vector<unsigned> seeds(blocks);
+    for (int b = 0; b < blocks; ++b)
+        seeds[b] = generator();
+
+    // Bonds inside a block are united by its thread, the ones leaving it wait for the merge
+    UnionFind sets(length);
+    std::vector<std::vector<std::pair<int, int> > > crossing(blocks);
+    parallelFor(threads, blocks, [&] (int first, int last) {
+        for (int b = first; b < last; ++b) {
+            const int begin = b * BLOCK_SITES, end = std::min(length, begin + BLOCK_SITES);
+            std::mt19937 random(seeds[b]);
+            freezeBonds(c, spins, kind, T, begin, end, random, [&] (const int& i, const int& j) {
+                if (begin <= j && j < end) sets.unite(i, j);
+                else crossing[b].emplace_back(i, j);
+            });
+        }
+    });
+    for (const std::vector<std::pair<int, int> >& bonds : crossing)
+        for (const std::pair<int, int>& bond : bonds)
+            sets.unite(bond.first, bond.second);
+
+    std::vector<int> label(length);
+    parallelFor(threads, length, [&] (int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            label[i] = sets.root(i);
+    });
+
+    // Every root draws the flip of its cluster, in site order
+    std::vector<double> field(length, 0.0);
+    for (auto const& it : c.fields)
+        if (it.first < length) field[label[it.first]] += fieldOf(c, spins, it.first);
+    std::vector<char> flip(length, 0);
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    [[maybe_unused]] long clusters = 0, accepts = 0;
+    for (int i = 0; i < length; ++i) {
+        if (label[i] != i) continue;
+        flip[i] = dis(generator) < flipProbability(-2.0 * field[i], T);
+        ++clusters;
+        accepts += flip[i];
+    }
+
+    std::atomic<long> flipped(0);
+    parallelFor(threads, length, [&] (int begin, int end) {
+        long count = 0;
+        for (int i = begin; i < end; ++i)
+            if (flip[label[i]]) {
+                spins[i] = (spins[i] == UP) ? DOWN : UP;
+                ++count;
+            }
+        flipped += count;
+    });
+    PROFILE_COUNT(profile::CLUSTER_MOVES, clusters);
+    PROFILE_COUNT(profile::CLUSTER_ACCEPTS, accepts);
+    PROFILE_COUNT(profile::CLUSTER_SPINS, flipped.load());
+    return flipped.load();
+}
+
+long wolff (const Couplings& c, std::vector<Spin>& spins, const double& T, const int& moves,
+            std::mt19937& generator) {
+    const int length = spins.size();
+    std::uniform_int_distribution<int> pick(0, length - 1);
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    std::vector<bool> in_cluster(length, false);
+    long total = 0;
+    for (int m = 0; m < moves; ++m) {
+        std::vector<int> cluster = { pick(generator) };
+        in_cluster[cluster.back()] = true;
+        double field               = 0.0;
+        for (int k = 0; k < (int)cluster.size(); ++k) {
+            const int i = cluster[k];
+            field += fieldOf(c, spins, i);
+            if (i >= (int)c.adj_list.size()) continue;
+            for (AdjNode *tmp = c.adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+                const int j = tmp->val;
+                if (in_cluster[j] || tmp->weight * (double)spins[i] * (double)spins[j] >= 0.0)
+                    continue;
+                if (dis(generator) < freezeProbability(tmp->weight, T)) {
+                    in_cluster[j] = true;
+                    cluster.push_back(j);
+                }
+            }
+        }
+        PROFILE_COUNT(profile::CLUSTER_MOVES, 1);
+
+        // Without fields the flip is always accepted, otherwise Metropolis on the field energy
+        const double delta_E = -2.0 * field;
+        const bool accept =
+            delta_E <= 0.0 || (T > 0.0 && dis(generator) < std::exp(-delta_E / T));
+        for (const int& i : cluster) {
+            in_cluster[i] = false;
+            if (accept) spins[i] = (spins[i] == UP) ? DOWN : UP;
+        }
+        if (!accept) continue;
+        total += cluster.size();
+        PROFILE_COUNT(profile::CLUSTER_ACCEPTS, 1);
+        PROFILE_COUNT(profile::CLUSTER_SPINS, cluster.size());
+    }
+    return total;
+}
+
+} // namespace cluster
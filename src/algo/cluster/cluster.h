@@ -0,0 +1,63 @@
+#ifndef _CLUSTER_H_
+#define _CLUSTER_H_
+
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../graph/Graph.h"
+
+/*
+ * Cluster moves of a classical configuration at temperature T, E = sum w s s + sum h s.
+ *
+ * Swendsen-Wang freezes every satisfied bond (w s_i s_j < 0) with probability 1 - exp(-2|w|/T)
+ * and flips every resulting cluster at once, Wolff grows and flips a single cluster of the same
+ * bonds. Both are exact for any couplings but only efficient when they are ferromagnetic.
+ *
+ * KBD (Kandel, Ben-Av, Domany) is for the antiferromagnetic --h-tri lattice, where the satisfied
+ * bonds percolate. The lattice is tiled by the triangles (i, right, bottom right) so every bond
+ * is in exactly one of them. A triangle in one of its ground states (one unsatisfied bond)
+ * freezes its two satisfied bonds with probability 1 - exp(-4J/T), otherwise nothing is frozen.
+ * KBD alone does not reach every configuration, it is meant to follow Metropolis sweeps.
+ *
+ * The clusters of a multi-cluster move are labeled with a union-find pass that the threads run
+ * over blocks of sites. The linear fields decide the flip of every cluster (heat bath), without
+ * fields a cluster flips with probability 1/2.
+ */
+namespace cluster {
+
+enum Kind { NONE, SWENDSEN_WANG, WOLFF, KBD };
+
+Kind fromName(const std::string&); // "sw", "wolff" or "kbd"
+
+// Disjoint sets of the sites
+class UnionFind {
+  private:
+    std::vector<int> parent;
+
+  public:
+    UnionFind(const int&);
+    int find(const int&);           // With path halving
+    int root(const int&) const;     // Read only, several threads may call it at once
+    void unite(const int&, const int&);
+};
+
+// What a cluster move reads of the graph
+struct Couplings {
+    const std::vector<AdjNode *>& adj_list;
+    const std::map<int, double>& fields;
+    int tri_length = 0; // Length of the --h-tri lattice, KBD only
+};
+
+// Swendsen-Wang or KBD move of every cluster, returns the spins flipped
+long multiCluster(const Couplings&, std::vector<Spin>&, const Kind&, const double&, const int&,
+                  std::mt19937&); // (couplings, spins, kind, T, threads, generator)
+// Wolff moves of single clusters, returns the spins flipped. The move count is fixed up front,
+// stopping once enough spins were in clusters would bias the sampling.
+long wolff(const Couplings&, std::vector<Spin>&, const double&, const int&,
+           std::mt19937&); // (couplings, spins, T, moves, generator)
+
+} // namespace cluster
+
+#endif
@@ -0,0 +1,228 @@
+#include "pa.h"
+#include "../../include/Parallel.h"
+#include "../../profile/Profile.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Grph_PA Constructor
+Anlr_PA::Grph_PA::Grph_PA () : Graph() {
+    return;
+}
+Anlr_PA::Grph_PA::Grph_PA (const Graph& g) : Graph(g) {
+    return;
+}
+
+// Grph_PA getEnergy, the sum of getHamiltonianEnergy over a replica
+double Anlr_PA::Grph_PA::getEnergy (const int8_t *config) const {
+    double sum = 0.0;
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i)
+        for (AdjNode *tmp = terms->adj_list[i]; tmp != nullptr; tmp = tmp->next)
+            if (tmp->val <= i) sum += tmp->weight * (double)config[i] * (double)config[tmp->val];
+    for (auto const& it : terms->constant_map)
+        sum += it.second * (double)config[it.first];
+    return sum + terms->constant;
+}
+
+// Grph_PA getDifference, self loops are constant and never change the energy
+double Anlr_PA::Grph_PA::getDifference (const int8_t *config, const int& index) const {
+    double field = 0.0;
+    if (index < (int)terms->adj_list.size())
+        for (AdjNode *tmp = terms->adj_list[index]; tmp != nullptr; tmp = tmp->next)
+            if (tmp->val != index) field += tmp->weight * (double)config[tmp->val];
+    std::map<int, double>::const_iterator it = terms->constant_map.find(index);
+    if (it != terms->constant_map.end()) field += it->second;
+    return -2.0 * (double)config[index] * field;
+}
+
+// Anlr_PA Constructor
+Anlr_PA::Anlr_PA () : Annealer(0), graph() {
+    return;
+}
+Anlr_PA::Anlr_PA (const Graph& g, const Params_PA& p) : Annealer(p.rank), graph(g), params(p) {
+    return;
+}
+
+// Anlr_PA getParams
+Params_PA Anlr_PA::getParams () const {
+    return this->params;
+}
+
+// Anlr_PA resample, systematic resampling to the same population size. The weights are taken
+// relative to the lowest energy so they never underflow together.
+double Anlr_PA::resample (const double& d_beta) {
+    const int length = graph.spins.size(), size = this->params.population;
+    const double min_energy = *std::min_element(this->energies.begin(), this->energies.end());
+    std::vector<double> weight(size);
+    double total = 0.0;
+    for (int r = 0; r < size; ++r) {
+        weight[r] = std::exp(-d_beta * (this->energies[r] - min_energy));
+        total += weight[r];
+    }
+
+    // Replica r copies ancestor[r], every replica gets floor or ceil of size * weight / total
+    std::vector<int> ancestor(size);
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    const double offset = dis(this->generator);
+    double cumulative   = weight[0];
+    for (int r = 0, a = 0; r < size; ++r) {
+        const double target = (r + offset) * total / size;
+        while (cumulative < target && a < size - 1)
+            cumulative += weight[++a];
+        ancestor[r] = a;
+    }
+
+    std::vector<double> energies(size);
+    std::vector<int> families(size);
+    parallelFor(this->params.threads, size, [&] (int begin, int end) {
+        for (int r = begin; r < end; ++r) {
+            std::memcpy(&this->scratch[(long)r * length],
+                        &this->population[(long)ancestor[r] * length], length);
+            energies[r] = this->energies[ancestor[r]];
+            families[r] = this->families[ancestor[r]];
+        }
+    });
+    this->population.swap(this->scratch);
+    this->energies = energies;
+    this->families = families;
+    return -d_beta * min_energy + std::log(total / size);
+}
+
+// Anlr_PA sweep, the replicas are independent so the threads share them out
+void Anlr_PA::sweep (const double& T) {
+    PROFILE_SCOPE(profile::SWEEP);
+    const int length = graph.spins.size(), size = this->params.population;
+    parallelFor(this->params.threads, size, [&] (int begin, int end) {
+        [[maybe_unused]] long accepts = 0;
+        std::uniform_real_distribution<double> dis(0.0, 1.0);
+        for (int r = begin; r < end; ++r) {
+            int8_t *config       = &this->population[(long)r * length];
+            std::mt19937& random = this->generators[r];
+            for (int j = 0; j < length; ++j) {
+                const double delta_E = graph.getDifference(config, j);
+                if (dis(random) < acceptance(delta_E, T)) {
+                    config[j] = -config[j];
+                    this->energies[r] += delta_E;
+                    ++accepts;
+                }
+            }
+        }
+        PROFILE_COUNT(profile::ACCEPTS, accepts);
+    });
+    PROFILE_COUNT(profile::PROPOSALS, (long)length * size);
+    return;
+}
+
+// Anlr_PA measure
+PopulationStep Anlr_PA::measure (const double& T) {
+    const int length = graph.spins.size(), size = this->params.population;
+    PopulationStep step;
+    step.T           = T;
+    step.free_energy = -T * this->log_z;
+
+    int lowest = 0;
+    double sum = 0.0;
+    for (int r = 0; r < size; ++r) {
+        sum += this->energies[r];
+        if (this->energies[r] < this->energies[lowest]) lowest = r;
+    }
+    step.mean_energy = sum / size;
+    step.min_energy  = this->energies[lowest];
+
+    std::vector<bool> seen(size, false);
+    for (const int& f : this->families) {
+        if (!seen[f]) ++step.families;
+        seen[f] = true;
+    }
+
+    if (step.min_energy < this->best.getEnergy()) {
+        std::vector<Spin> config(length);
+        for (int i = 0; i < length; ++i)
+            config[i] = (Spin)this->population[(long)lowest * length + i];
+        this->best.restore(step.min_energy, config);
+    }
+    return step;
+}
+
+// Anlr_PA anneal
+double Anlr_PA::anneal () {
+    PROFILE_SCOPE(profile::ANNEAL);
+    const double temp0 = this->params.init_t, final_temp = this->params.final_t;
+    const int tau = this->params.tau, length = graph.spins.size();
+    const int size = this->params.population;
+    this->params.schedule.check(temp0, final_temp);
+    this->startClock();
+
+    // Random replicas are the equilibrium at beta = 0, where Z = 2^spins
+    this->population.resize((long)size * length);
+    this->scratch.resize((long)size * length);
+    this->energies.resize(size);
+    this->families.resize(size);
+    this->generators.resize(size);
+    std::bernoulli_distribution coin(0.5);
+    for (int r = 0; r < size; ++r) {
+        this->generators[r].seed(this->generator());
+        for (int i = 0; i < length; ++i)
+            this->population[(long)r * length + i] = coin(this->generators[r]) ? UP : DOWN;
+        this->energies[r] = graph.getEnergy(&this->population[(long)r * length]);
+        this->families[r] = r;
+    }
+    this->log_z = length * std::log(2.0);
+    this->history.clear();
+
+    double beta = 0.0;
+    for (int i = this->start_step; this->running(i, tau); ++i) {
+        const double T = this->params.schedule.at(this->progress(i, tau), temp0, final_temp);
+        if (T <= 0.0) throw std::invalid_argument("Population annealing needs T > 0");
+        this->log_z += this->resample(1 / T - beta);
+        beta = 1 / T;
+        for (int k = 0; k < this->params.sweeps_per_step; ++k)
+            this->sweep(T);
+
+        this->history.push_back(this->measure(T));
+        if (this->observing())
+            this->observe(this->history.back().min_energy, this->params.sweeps_per_step);
+        this->stopped = this->agreeStop(i);
+    }
+
+    // Keep the best replica, the population is dropped
+    this->graph.spins = this->best.getBest(graph.spins);
+    std::vector<int8_t>().swap(this->population);
+    std::vector<int8_t>().swap(this->scratch);
+    std::vector<std::mt19937>().swap(this->generators);
+    return this->graph.getHamiltonianEnergy();
+}
+
+// Anlr_PA polish
+double Anlr_PA::polish () {
+    PROFILE_SCOPE(profile::POLISH);
+    [[maybe_unused]] const int flips = graph.descend(graph.spins, 0, graph.spins.size());
+    PROFILE_COUNT(profile::POLISH_FLIPS, flips);
+    const double energy = graph.getHamiltonianEnergy();
+    this->best.update(energy);
+    return energy;
+}
+
+// Anlr_PA Getter
+double Anlr_PA::getFreeEnergy () const {
+    return this->history.empty() ? 0.0 : this->history.back().free_energy;
+}
+std::vector<PopulationStep> Anlr_PA::getHistory () const {
+    return this->history;
+}
+
+// Anlr_PA Reexported functions from Graph
+int Anlr_PA::getLength () const {
+    return this->graph.getLength();
+}
+int Anlr_PA::getHeight () const {
+    return this->graph.getHeight();
+}
+std::vector<Spin> Anlr_PA::getSpins () const {
+    return this->graph.getSpins();
+}
+double Anlr_PA::getHamiltonianEnergy () const {
+    return this->graph.getHamiltonianEnergy();
+}
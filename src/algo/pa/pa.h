@@ -0,0 +1,82 @@
+#ifndef _PA_H_
+#define _PA_H_
+
+#include <cstdint>
+#include <random>
+
+#include "../../annealer/Annealer.h"
+#include "../../annealer/Schedule.h"
+#include "../../include/AnnealFunc.h"
+
+struct Params_PA {
+    int rank            = 0;
+    double init_t       = 2.0;
+    double final_t      = 0.1;  // Positive, the free energy needs a finite beta
+    int tau             = 100;  // Temperature steps
+    int population      = 1000; // Replicas cooled together
+    Schedule schedule;          // Temperature from init_t to final_t over the tau steps
+    int sweeps_per_step = 10;   // Sweeps of every replica at every temperature
+    int threads         = 1;    // Threads the replicas are spread over
+};
+
+// Population statistics after the sweeps of a temperature step
+struct PopulationStep {
+    double T           = 0.0;
+    double free_energy = 0.0; // -T ln Z
+    double mean_energy = 0.0;
+    double min_energy  = 0.0;
+    int families       = 0; // Initial replicas that still have descendants
+};
+
+/*
+ * Population annealing: a population of replicas is cooled together. At every temperature step
+ * the replicas are reweighted by exp(-(beta' - beta) E) and resampled to the same size, then
+ * swept with Metropolis at the new temperature. The normalization of the weights gives ln Z,
+ * so the run also estimates the free energy.
+ */
+class Anlr_PA : public Annealer {
+  private:
+    class Grph_PA : public Graph {
+        friend class Anlr_PA;
+
+      public:
+        Grph_PA();
+        Grph_PA(const Graph&);
+        double getEnergy(const int8_t *) const;                 // Energy of a replica
+        double getDifference(const int8_t *, const int&) const; // Delta E of a flip of a replica
+    };
+    Grph_PA graph;
+    Params_PA params;
+    std::vector<int8_t> population, scratch; // Replica r at [r * spins, (r + 1) * spins), +-1
+    std::vector<double> energies;            // Energy of every replica
+    std::vector<int> families;               // Initial replica every replica descends from
+    std::vector<std::mt19937> generators;    // One per population slot, whatever the threads
+    double log_z = 0.0;                      // ln Z at the current temperature
+    std::vector<PopulationStep> history;
+
+    double resample(const double&); // beta step, returns ln Q (the ratio of partition functions)
+    void sweep(const double&);      // One Metropolis sweep of every replica at temperature T
+    PopulationStep measure(const double&); // T, also tracks the best replica
+
+  public:
+    Anlr_PA();
+    Anlr_PA(const Graph&, const Params_PA&);
+    Params_PA getParams() const;
+
+    // Virtual functions
+    double anneal();
+
+    double polish(); // Steepest descent of the best replica, returns its energy
+
+    // Getter
+    double getFreeEnergy() const; // -T ln Z at the last temperature
+    std::vector<PopulationStep> getHistory() const;
+
+    // Reexported functions from Graph, the graph holds the best replica after anneal
+    int getLength() const;
+    int getHeight() const;
+    std::vector<Spin> getSpins() const;
+    double getHamiltonianEnergy() const;
+};
+
+#endif
@@ -0,0 +1,187 @@
+#ifdef USE_MPI
+
+#include "./psa.h"
+#include "../../profile/Profile.h"
+#include <cmath>
+#include <stdexcept>
+
+// Grph_PSA Constructor
+Anlr_PSA::Grph_PSA::Grph_PSA () : Graph() {
+    return;
+}
+
+// Grph_PSA reserve, owned spins come first in the local index space
+void Anlr_PSA::Grph_PSA::reserve (const int& owned) {
+    if ((int)terms->adj_list.size() < owned) mutableTerms().adj_list.resize(owned, nullptr);
+    if ((int)spins.size() < owned) spins.resize(owned, UP);
+    return;
+}
+
+// Anlr_PSA Constructor
+Anlr_PSA::Anlr_PSA (const MpiPartition& p, const Params_SA& prms)
+    : Annealer(prms.rank), graph(), part(p), params(prms) {
+    this->graph.reserve(this->part.getOwnedCount());
+    return;
+}
+
+// Anlr_PSA getParams
+Params_SA Anlr_PSA::getParams () const {
+    return this->params;
+}
+
+/* Graph construction */
+
+void Anlr_PSA::pushBack (const int& po1, const int& po2, const double& co) {
+    if (!part.isOwned(po1) && !part.isOwned(po2)) return; // Belongs to other ranks only
+    const int l1 = part.toLocal(po1), l2 = part.toLocal(po2);
+    this->graph.Graph::pushBack(l1, l2, co);
+    return;
+}
+
+void Anlr_PSA::pushBack (const int& po, const double& co) {
+    if (!part.isOwned(po)) return;
+    this->graph.Graph::pushBack(part.toLocal(po), co);
+    return;
+}
+
+void Anlr_PSA::pushBack (const double& co) {
+    if (this->myrank == 0) this->graph.Graph::pushBack(co); // Count the constant once
+    return;
+}
+
+void Anlr_PSA::lockPartition () {
+    this->graph.reserve(this->part.getLocalCount());
+    this->graph.lockLength(this->part.getOwnedCount());
+    this->part.lock();
+
+    std::vector<int> inner;
+    boundary.clear();
+    const int owned = this->part.getOwnedCount();
+    for (int i = 0; i < owned; ++i) {
+        bool is_boundary = false;
+        for (AdjNode *tmp = graph.terms->adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+            if (tmp->val >= owned) {
+                is_boundary = true;
+                break;
+            }
+        }
+        if (is_boundary) boundary.push_back(i);
+        else inner.push_back(i);
+    }
+    // Contiguous shares, the interior is swept once per sweep spread over the color phases
+    const int colors = this->part.getColorCount();
+    interior.assign(colors, std::vector<int>());
+    for (int k = 0; k < (int)inner.size(); ++k)
+        interior[(long)k * colors / (long)inner.size()].push_back(inner[k]);
+    return;
+}
+
+void Anlr_PSA::resume (const Checkpoint& c) {
+    if (c.func != ANNEAL_FUNC::SA || c.spins.size() != this->graph.spins.size())
+        throw std::invalid_argument("Checkpoint does not match the partition of this rank");
+    this->graph.spins = c.spins;
+    this->restoreCheckpoint(c);
+    return;
+}
+
+// Metropolis sweep over the given local indices
+void Anlr_PSA::sweep (const std::vector<int>& indices, const double& T) {
+    PROFILE_SCOPE(profile::SWEEP);
+    [[maybe_unused]] long accepts = 0;
+    for (const int& j : indices) {
+        // Calculate the PI_accept
+        const double delta_E   = graph.getHamiltonianDifference(j);
+        const double PI_accept = acceptance(delta_E, T);
+
+        // Flip the spin with probability PI_accept
+        if (this->randomExec(PI_accept, [&] () { graph.flipSpin(j); })) {
+            ++accepts;
+            this->local_delta += delta_E;
+            this->best.record(j, graph.spins);
+        }
+    }
+    PROFILE_COUNT(profile::PROPOSALS, indices.size());
+    PROFILE_COUNT(profile::ACCEPTS, accepts);
+    return;
+}
+
+// Anlr_PSA anneal
+double Anlr_PSA::anneal () {
+    PROFILE_SCOPE(profile::ANNEAL);
+    const double temp0 = this->params.init_t, final_temp = this->params.final_t;
+    const int tau = this->params.tau, color = part.getColor();
+    this->params.schedule.check(temp0, final_temp);
+    this->startClock();
+    double energy = this->getHamiltonianEnergy();
+    this->best.update(energy);
+    for (int i = this->start_step; this->running(i, tau); ++i) {
+        const double T = this->params.schedule.at(this->progress(i, tau), temp0, final_temp);
+        for (int k = 0; k < this->params.sweeps_per_step; ++k) {
+            // One phase per rank color, only the active ranks sweep their boundary and send it.
+            // Interior spins have no halo neighbor, every rank sweeps a share of them in every
+            // phase while the exchange is in flight.
+            for (int c = 0; c < part.getColorCount(); ++c) {
+                if (c == color) this->sweep(boundary, T);
+                part.post(graph.spins, c);
+                this->sweep(interior[c], T);
+                part.wait(graph.spins);
+            }
+        }
+        // Neighboring ranks never flip at the same time, so the local changes add up exactly.
+        // Every rank sees the same energy, takes the same best and stops together.
+        energy += this->part.reduce(this->local_delta);
+        this->local_delta = 0.0;
+        this->best.update(energy);
+        if (this->observing()) this->observe(energy, this->params.sweeps_per_step);
+        this->stopped = this->part.any(this->stopping());
+        // Every rank checkpoints its own local spins (owned and halo), agreeing on when to
+        if (this->part.any(this->checkpointDue(i + 1)))
+            this->saveCheckpoint(ANNEAL_FUNC::SA, i + 1, T, graph.spins);
+    }
+    // End on the best configuration seen, the halo only holds the owned flips of the journal
+    this->graph.spins = this->best.getBest(graph.spins);
+    for (int c = 0; c < part.getColorCount(); ++c)
+        part.exchange(graph.spins, c);
+    return this->getHamiltonianEnergy();
+}
+
+int Anlr_PSA::getTotal () const {
+    return this->part.getTotal();
+}
+int Anlr_PSA::getColorCount () const {
+    return this->part.getColorCount();
+}
+
+// Anlr_PSA getHamiltonianEnergy
+double Anlr_PSA::getHamiltonianEnergy () const {
+    double sum      = 0.0;
+    const int owned = this->part.getOwnedCount();
+    for (int i = 0; i < owned; ++i) {
+        const double spin = (double)graph.spins[i];
+        const int global  = part.toGlobal(i);
+        // Count every edge on the rank owning its larger endpoint
+        for (AdjNode *tmp = graph.terms->adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+            if (part.toGlobal(tmp->val) > global) continue;
+            sum += tmp->weight * spin * (double)graph.spins[tmp->val];
+        }
+    }
+    // Calculate the linear terms
+    for (auto const& it : graph.terms->constant_map) {
+        sum += it.second * (double)graph.spins[it.first];
+    }
+    // Calculate the constant term
+    sum += graph.terms->constant;
+    return this->part.reduce(sum);
+}
+
+// Anlr_PSA printConfig
+void Anlr_PSA::printConfig (std::ofstream& out, const std::vector<int64_t>& ids) const {
+    const int owned = this->part.getOwnedCount();
+    for (int i = 0; i < owned; ++i) {
+        const int global = part.toGlobal(i);
+        out << (ids.empty() ? (int64_t)global : ids[global]) << " " << graph.spins[i] << std::endl;
+    }
+    return;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef _PSA_H_
+#define _PSA_H_
+
+#ifdef USE_MPI
+
+#include "../../annealer/Annealer.h"
+#include "../../annealer/MpiPartition.h"
+#include "../../include/AnnealFunc.h"
+#include "../sa/sa.h"
+
+/*
+ * Partitioned simulated annealing: a single graph split across MPI ranks.
+ * Edges are pushed with global indices, only the ones touching the owned range are kept.
+ */
+class Anlr_PSA : public Annealer {
+  private:
+    class Grph_PSA : public Graph {
+        friend class Anlr_PSA;
+
+      public:
+        Grph_PSA();
+        void reserve(const int&); // Make room for the owned spins
+    };
+    Grph_PSA graph;
+    MpiPartition part;
+    Params_SA params;
+    std::vector<std::vector<int> > interior; // Owned, no halo neighbor, a share per color phase
+    std::vector<int> boundary;               // Owned local indices with a halo neighbor
+    double local_delta = 0.0;                // Energy change of the owned flips since last step
+
+    void sweep(const std::vector<int>&, const double&);
+
+  public:
+    Anlr_PSA(const MpiPartition&, const Params_SA&);
+    Params_SA getParams() const;
+
+    /* Graph construction (global indices) */
+    void pushBack(const int&, const int&, const double&); // Push back an edge
+    void pushBack(const int&, const double&);             // Push back a constant_map
+    void pushBack(const double&);                         // Push back a constant
+    void lockPartition(); // Build the halo exchange plan, call after the last pushBack
+    void resume(const Checkpoint&); // Continue from this rank's checkpoint (same rank count)
+
+    // Virtual functions
+    double anneal();
+
+    // Getter
+    int getTotal() const;
+    int getColorCount() const;
+    double getHamiltonianEnergy() const; // Collective, the energy of the whole graph
+
+    // Printer
+    void printConfig(std::ofstream&, const std::vector<int64_t>&)
+        const; // Owned spins only (input ID of the global index, spin), IDs empty: the index
+};
+
+#endif
+
+#endif
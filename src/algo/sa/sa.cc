@@ -1,5 +1,7 @@
 #include "./sa.h"
+#include "../../profile/Profile.h"
 #include <cmath>
+#include <stdexcept>
 
 #ifdef USE_MPI
 #include "../../annealer/MpiAnnealer.h"
@@ -45,22 +47,109 @@ void Anlr_SA::printHLayer (std::ofstream& out) const {
     return this->graph.printHLayer(out);
 }
 
+// Anlr_SA sweep
+void Anlr_SA::sweep (const double& T) {
+    PROFILE_SCOPE(profile::SWEEP);
+    [[maybe_unused]] long accepts = 0;
+    const int length              = graph.spins.size();
+    for (int j = 0; j < length; ++j) {
+        // Calculate the PI_accept
+        const double delta_E   = graph.getHamiltonianDifference(j);
+        const double PI_accept = acceptance(delta_E, T);
+
+        // Flip the spin with probability PI_accept
+        if (this->randomExec(PI_accept, [&] () { graph.flipSpin(j); })) {
+            ++accepts;
+            this->energy += delta_E;
+            this->best.flip(j, this->energy, graph.spins);
+            this->order.flip(j, graph.spins[j]);
+        }
+
+        if (print_progress) std::cout << T << " " << graph.getHamiltonianEnergy() << std::endl;
+    }
+    PROFILE_COUNT(profile::PROPOSALS, length);
+    PROFILE_COUNT(profile::ACCEPTS, accepts);
+    return;
+}
+
+// Anlr_SA overlapCluster. The sites where this replica and the other disagree are the negative
+// overlap, the cluster is the connected part of it around a random site. Flipping it in both
+// replicas swaps their spins on it, so the sum of the two energies is unchanged and the move is
+// always accepted.
+std::vector<int> Anlr_SA::overlapCluster (const std::vector<Spin>& other) {
+    PROFILE_SCOPE(profile::CLUSTER);
+    std::vector<int> negative;
+    for (int i = 0; i < (int)graph.spins.size(); ++i)
+        if (graph.spins[i] != other[i]) negative.push_back(i);
+    if (negative.empty()) return negative;
+
+    std::uniform_int_distribution<int> pick(0, negative.size() - 1);
+    std::vector<bool> in_cluster(graph.spins.size(), false);
+    std::vector<int> cluster   = { negative[pick(this->generator)] };
+    in_cluster[cluster.back()] = true;
+    for (int k = 0; k < (int)cluster.size(); ++k) {
+        const int i = cluster[k];
+        if (i >= (int)graph.terms->adj_list.size()) continue;
+        for (AdjNode *tmp = graph.terms->adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+            const int j = tmp->val;
+            if (in_cluster[j] || graph.spins[j] == other[j]) continue;
+            in_cluster[j] = true;
+            cluster.push_back(j);
+        }
+    }
+    return cluster;
+}
+
+// Anlr_SA flipCluster, the energy follows the flip delta of each spin taken before its flip, so
+// spins of the cluster that are neighbours see each other's earlier flips
+void Anlr_SA::flipCluster (const std::vector<int>& cluster) {
+    PROFILE_COUNT(profile::CLUSTER_MOVES, 1);
+    if (cluster.empty()) return;
+    for (const int& j : cluster) {
+        this->energy += graph.getHamiltonianDifference(j);
+        graph.flipSpin(j);
+        this->best.flip(j, this->energy, graph.spins);
+        this->order.flip(j, graph.spins[j]);
+    }
+    PROFILE_COUNT(profile::CLUSTER_ACCEPTS, 1);
+    PROFILE_COUNT(profile::CLUSTER_SPINS, cluster.size());
+    return;
+}
+
+// Anlr_SA clusterMove, the move is not journaled so the energy is recomputed
+void Anlr_SA::clusterMove (const double& T) {
+    PROFILE_SCOPE(profile::CLUSTER);
+    this->best.freeze(graph.spins);
+    const cluster::Couplings couplings = { graph.terms->adj_list, graph.terms->constant_map,
+                                           this->params.tri_length };
+    if (this->params.cluster_move == cluster::WOLFF)
+        cluster::wolff(couplings, graph.spins, T, 1, this->generator);
+    else
+        cluster::multiCluster(couplings, graph.spins, this->params.cluster_move, T,
+                              this->params.threads, this->generator);
+    this->energy = graph.getHamiltonianEnergy();
+    this->best.update(this->energy);
+    this->order.reset(graph.spins);
+    return;
+}
+
 // Anlr_SA anneal
 double Anlr_SA::anneal () {
+    PROFILE_SCOPE(profile::ANNEAL);
     const double temp0 = this->params.init_t, final_temp = this->params.final_t;
     const int tau = this->params.tau;
-    for (int i = 0; i <= tau; ++i) {
-        const double T   = temp0 * (1 - ((double)i / tau)) + final_temp * ((double)i / tau);
-        const int length = graph.spins.size();
-        for (int j = 0; j < length; ++j) {
-            // Calculate the PI_accept
-            const double delta_E   = graph.getHamiltonianDifference(j);
-            const double PI_accept = std::min(1.0, std::exp(-delta_E / T));
-
-            // Flip the spin with probability PI_accept
-            this->randomExec(PI_accept, [&] () { graph.flipSpin(j); });
-
-            if (print_progress) std::cout << T << " " << graph.getHamiltonianEnergy() << std::endl;
+    this->params.schedule.check(temp0, final_temp);
+    this->startClock();
+    this->energy = graph.getHamiltonianEnergy();
+    this->best.update(this->energy);
+    this->order.reset(graph.spins);
+    for (int i = this->start_step; this->running(i, tau); ++i) {
+        const double T = this->params.schedule.at(this->progress(i, tau), temp0, final_temp);
+        for (int k = 0; k < this->params.sweeps_per_step; ++k) {
+            this->sweep(T);
+            if (this->params.cluster_move != cluster::NONE) this->clusterMove(T);
+            this->order.sweep(T);
+            if (this->observing()) this->observe(this->energy, 1);
         }
 
 #ifdef USE_MPI
@@ -68,15 +157,60 @@ double Anlr_SA::anneal () {
                                    double& target_energy) {
             return ((1 / target_temp) - (1 / src_temp)) * (target_energy - src_energy);
         };
-        if (i % 8 == 0) {
+        if (this->params.houdayer) {
+            // The pair anneals on the same schedule, so both replicas are at temperature T
+            this->flipCluster(houdayer(this->myrank, graph.spins, [&] (const std::vector<Spin>& o) {
+                return this->overlapCluster(o);
+            }));
+        }
+        if (i % EXCHANGE_INTERVAL == 0) {
             std::vector<Spin> config = this->graph.getSpins();
-            swap(this->myrank, T, graph.getHamiltonianEnergy(), config, deltaS);
+            if (swap(this->myrank, T, graph.getHamiltonianEnergy(), config, deltaS)) {
+                this->best.freeze(graph.spins); // The swap is not journaled
+                this->graph.spins = config;
+                this->energy      = graph.getHamiltonianEnergy();
+                this->best.update(this->energy);
+                this->order.reset(graph.spins);
+            }
         }
 #endif
+        this->stopped = this->agreeStop(i);
+        if (this->checkpointDue(i + 1))
+            this->saveCheckpoint(ANNEAL_FUNC::SA, i + 1, T, graph.spins);
     }
+    // End on the best configuration seen
+    this->graph.spins = this->best.getBest(graph.spins);
     return this->graph.getHamiltonianEnergy();
 }
 
+// Anlr_SA measure, a sample after every sweep past the thermalization. Nothing is exchanged
+// with other replicas, they are independent runs at the same temperature.
+void Anlr_SA::measure (Measurement& m, const int& thermalize, const int& sweeps) {
+    PROFILE_SCOPE(profile::ANNEAL);
+    const double T = this->params.init_t;
+    if (T <= 0.0) throw std::invalid_argument("--measure needs a positive temperature");
+    this->startClock();
+    this->energy = graph.getHamiltonianEnergy();
+    this->best.update(this->energy);
+    this->order.reset(graph.spins);
+    for (int i = 0; i < thermalize + sweeps && !this->stopping(); ++i) {
+        this->sweep(T);
+        if (this->params.cluster_move != cluster::NONE) this->clusterMove(T);
+        if (i >= thermalize) m.add(this->energy, graph.spins, this->order);
+    }
+    return;
+}
+
+// Anlr_SA polish
+double Anlr_SA::polish () {
+    PROFILE_SCOPE(profile::POLISH);
+    [[maybe_unused]] const int flips = graph.descend(graph.spins, 0, graph.spins.size());
+    PROFILE_COUNT(profile::POLISH_FLIPS, flips);
+    this->energy = graph.getHamiltonianEnergy();
+    this->best.update(this->energy);
+    return this->energy;
+}
+
 // Anlr_SA getHamiltonianEnergy
 double Anlr_SA::getHamiltonianEnergy () const {
     return this->graph.getHamiltonianEnergy();
@@ -92,3 +226,11 @@ void Anlr_SA::setSpins (const int index, const int value) {
     this->graph.setSpin(index, value);
     return;
 }
+
+void Anlr_SA::resume (const Checkpoint& c) {
+    if (c.func != ANNEAL_FUNC::SA || c.spins.size() != this->graph.spins.size())
+        throw std::invalid_argument("Checkpoint does not match the SA graph");
+    this->graph.spins = c.spins;
+    this->restoreCheckpoint(c);
+    return;
+}
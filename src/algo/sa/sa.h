@@ -2,12 +2,22 @@
 #define _SA_H_
 
 #include "../../annealer/Annealer.h"
+#include "../../annealer/Measurement.h"
+#include "../../annealer/Schedule.h"
+#include "../../include/AnnealFunc.h"
+#include "../cluster/cluster.h"
 
 struct Params_SA {
-    int rank       = 0;
-    double init_t  = 2.0;
-    double final_t = 0.0;
-    int tau        = 1000;
+    int rank                   = 0;
+    double init_t              = 2.0;
+    double final_t             = 0.0;
+    int tau                    = 1000;
+    Schedule schedule;                          // Temperature from init_t to final_t over tau steps
+    int sweeps_per_step        = 1;             // Sweeps at every temperature of the schedule
+    bool houdayer              = false;         // Houdayer move with the partner replica (MPI)
+    cluster::Kind cluster_move = cluster::NONE; // Cluster move after every sweep
+    int tri_length             = 0;             // Length of the --h-tri lattice, for KBD
+    int threads                = 1;             // Threads of the cluster labeling
 };
 
 class Anlr_SA : public Annealer {
@@ -21,6 +31,12 @@ class Anlr_SA : public Annealer {
     };
     Grph_SA graph;
     Params_SA params;
+    double energy = 0.0; // Current energy, tracked by the sweeps
+
+    void sweep(const double&); // One Metropolis sweep at temperature T
+    std::vector<int> overlapCluster(const std::vector<Spin>&); // Houdayer cluster with a replica
+    void flipCluster(const std::vector<int>&);                 // Flip the given spins
+    void clusterMove(const double&); // The cluster move of the params at temperature T
 
   public:
     Anlr_SA();
@@ -30,6 +46,10 @@ class Anlr_SA : public Annealer {
     // Virtual functions
     double anneal();
 
+    double polish(); // Steepest descent of the annealed configuration, returns its energy
+    void measure(Measurement&, const int&,
+                 const int&); // Equilibrium at init_t: thermalize sweeps, then sampled sweeps
+
     // Reexported functions from Graph
     int getLength() const;
     int getHeight() const;
@@ -51,6 +71,7 @@ class Anlr_SA : public Annealer {
 
     // Graph maanipulator
     void setSpins(const int index, const int value);
+    void resume(const Checkpoint&); // Continue from a checkpoint of the same graph
 };
 
 #endif
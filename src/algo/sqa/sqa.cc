@@ -1,6 +1,10 @@
 #include "sqa.h"
+#include "../../profile/Profile.h"
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
 #include <numeric>
+#include <stdexcept>
 
 #ifdef USE_MPI
 #include "../../annealer/MpiAnnealer.h"
@@ -24,10 +28,12 @@ void Anlr_SQA::Grph_SQA::updateGamma (const double& gamma) {
     char gamma_update_flag = 0X00; // check if gamma is updated for both up and down
     const int length       = this->getLength();
     const int height       = this->spins.size() / length;
-    for (int i = 0; i < adj_list.size(); ++i) {
-        AdjNode *tmp             = adj_list[i];
+    if (height < 2) return; // A single layer has no Trotter edges, only its own self loops
+    Hamiltonian& h         = this->mutableTerms(); // A replica changes its own copy only
+    for (int i = 0; i < (int)h.adj_list.size(); ++i) {
+        AdjNode *tmp             = h.adj_list[i];
         const int next_layer_idx = (i + length) % (length * height);
-        const int prev_layer_idx = (i - length) >= 0 ? i - length : i % length;
+        const int prev_layer_idx = (i - length + length * height) % (length * height);
         while (tmp != nullptr) {
             if (!(gamma_update_flag ^ 0X03)) { // if gamma_update_flag == 0X03
                 break;
@@ -63,30 +69,32 @@ inline double loge (double x) {
 }
 void Anlr_SQA::Grph_SQA::growLayer (const int& grow_count, const double& gamma) {
     const int length = this->getLength();
-    const int height = this->spins.size() / length, origin_constant = this->constant / height;
+    Hamiltonian& h   = this->mutableTerms(); // A replica grows its own copy only
+    const int height             = this->spins.size() / length;
+    const double origin_constant = h.constant / height;
     const double g = (-0.5) * loge(tanh(gamma));
     for (int i = 0; i < grow_count; ++i) {
         // Duplicate the current layer to the new layer
         for (int j = 0; j < length; ++j) {
             const int index = (i + 1) * length + j; // New layer's index
             // Add edge between the new layer
-            AdjNode *tmp    = adj_list[j];
+            AdjNode *tmp    = h.adj_list[j];
             while (tmp != nullptr) {
                 const int corr_node = tmp->val + (length * (i + 1));
                 if (tmp->val == j + length) { // Prevent from adding edge to the next layer
                     tmp = tmp->next;
                     continue;
                 }
-                // Prevent from adding duplicate edge
-                if (index < corr_node) this->pushBack(index, corr_node, tmp->weight);
+                // Prevent from adding duplicate edge, a self loop is stored once
+                if (index <= corr_node) this->pushBack(index, corr_node, tmp->weight);
                 tmp = tmp->next;
             }
             // Add constant map of the new layer
-            if (constant_map.find(j) != constant_map.end()) {
-                this->pushBack(index, constant_map[j]);
+            if (h.constant_map.find(j) != h.constant_map.end()) {
+                this->pushBack(index, h.constant_map[j]);
             }
         }
-        this->constant += origin_constant; // Add constant of the new layer
+        h.constant += origin_constant; // Add constant of the new layer
         // Add edge between the new layer & the previous layer
         for (int j = 0; j < length; ++j) {
             const int index          = i * length + j; // Previous layer's index
@@ -97,7 +105,7 @@ void Anlr_SQA::Grph_SQA::growLayer (const int& grow_count, const double& gamma)
         }
     }
     // Link back to the first layer
-    for (int j = 0; j < length; ++j) {
+    for (int j = 0; j < length && grow_count > 0; ++j) {
         const int index          = grow_count * length + j;
         const int next_layer_idx = j;
         // std::cout << "index = " << index << " next_layer_idx = " << next_layer_idx << std::endl;
@@ -106,6 +114,54 @@ void Anlr_SQA::Grph_SQA::growLayer (const int& grow_count, const double& gamma)
     return;
 }
 
+// Grph_SQA getDifferences, same sum as getHamiltonianDifference but also split out the classical
+// (in-layer and linear) part
+double Anlr_SQA::Grph_SQA::getDifferences (const int& index, double& classical) {
+    const int layer_begin = index - index % this->length, layer_end = layer_begin + this->length;
+    double sum_to_modify = 0.0, in_layer = 0.0;
+    const double spin    = (double)spins[index];
+    for (AdjNode *tmp = terms->adj_list[index]; tmp != nullptr; tmp = tmp->next) {
+        if (tmp->val == index) continue; // Self loops are constant, they never change the energy
+        const double term = tmp->weight * spin * (double)spins[tmp->val];
+        sum_to_modify += term;
+        if (tmp->val >= layer_begin && tmp->val < layer_end) in_layer += term;
+    }
+    std::map<int, double>::const_iterator it = terms->constant_map.find(index);
+    if (it != terms->constant_map.end()) {
+        sum_to_modify += it->second * spin;
+        in_layer += it->second * spin;
+    }
+    classical = -2.0 * in_layer;
+    return -2.0 * sum_to_modify;
+}
+
+// Grph_SQA getLayerEnergies, the classical energy of every layer of the given configuration
+std::vector<double> Anlr_SQA::Grph_SQA::getLayerEnergies (const std::vector<Spin>& config,
+                                                          const double& constant) const {
+    const int height = config.size() / this->length;
+    std::vector<double> energy(height, constant);
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i) {
+        const int layer_begin = i - i % this->length;
+        for (AdjNode *tmp = terms->adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+            if (tmp->val > i || tmp->val < layer_begin) continue; // Each in-layer edge once
+            energy[i / this->length] += tmp->weight * (double)config[i] * (double)config[tmp->val];
+        }
+    }
+    for (auto const& it : terms->constant_map)
+        energy[it.first / this->length] += it.second * (double)config[it.first];
+    return energy;
+}
+
+// Grph_SQA getTrotterWeight, summed over the parallel edges (two of them with two layers)
+double Anlr_SQA::Grph_SQA::getTrotterWeight () const {
+    const int next = this->length % this->spins.size();
+    double weight  = 0.0;
+    if (next == 0) return weight; // A single layer
+    for (AdjNode *tmp = terms->adj_list[0]; tmp != nullptr; tmp = tmp->next)
+        if (tmp->val == next) weight += tmp->weight;
+    return weight;
+}
+
 // Anlr_SQA Constructor
 Anlr_SQA::Anlr_SQA () : Annealer(0), graph() {}
 Anlr_SQA::Anlr_SQA (const Graph& g, const int& rank) : Annealer(rank), graph(g) {}
@@ -125,41 +181,219 @@ void Anlr_SQA::printHLayer (std::ofstream& out) const {
     return this->graph.printHLayer(out);
 }
 
+// Anlr_SQA resetLayerEnergy
+void Anlr_SQA::resetLayerEnergy () {
+    this->layer_energy = graph.getLayerEnergies(graph.spins, this->classical_constant);
+    for (int l = 0; l < (int)this->layer_energy.size(); ++l)
+        if (this->best.update(this->layer_energy[l])) this->best_layer = l;
+    this->order.reset(graph.spins);
+    return;
+}
+
+// Anlr_SQA sweep
+void Anlr_SQA::sweep () {
+    PROFILE_SCOPE(profile::SWEEP);
+    [[maybe_unused]] long accepts = 0;
+    const int length              = graph.spins.size();
+    const int layer_length        = graph.getLength();
+    for (int j = 0; j < length; ++j) {
+        // Calculate the PI_accept
+        double classical_delta_E;
+        const double delta_E   = graph.getDifferences(j, classical_delta_E);
+        const double PI_accept = std::min(1.0, std::exp(-delta_E));
+
+        // Flip the spin with probability PI_accept
+        if (this->randomExec(PI_accept, [&] () { graph.flipSpin(j); })) {
+            ++accepts;
+            const int layer = j / layer_length;
+            this->layer_energy[layer] += classical_delta_E;
+            if (this->best.flip(j, this->layer_energy[layer], graph.spins)) this->best_layer = layer;
+            this->order.flip(j, graph.spins[j]);
+        }
+    }
+    PROFILE_COUNT(profile::PROPOSALS, length);
+    PROFILE_COUNT(profile::ACCEPTS, accepts);
+    return;
+}
+
+// Anlr_SQA worldlineSweep. Wolff along the Trotter direction: from a random slice of a spin the
+// segment grows over each satisfied inter-slice bond with probability 1 - exp(-2 |J|), so the
+// Trotter energy cancels out of the acceptance and the segment (or the whole worldline) flips
+// with the Metropolis acceptance of its in-layer energy alone.
+void Anlr_SQA::worldlineSweep () {
+    PROFILE_SCOPE(profile::CLUSTER);
+    const int length = graph.getLength(), height = graph.spins.size() / length;
+    if (height < 2) return;
+    const double bond = graph.getTrotterWeight();
+    const double grow = 1 - std::exp(-2 * std::abs(bond));
+    std::uniform_int_distribution<int> slice(0, height - 1);
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    [[maybe_unused]] long accepts = 0, flipped = 0;
+    std::vector<int> segment;
+    std::vector<double> classical;
+    for (int i = 0; i < length; ++i) {
+        // Bonds are satisfied when their energy bond * s * s' is negative
+        auto joins = [&] (const int& from, const int& to) {
+            const double s = (double)graph.spins[from * length + i];
+            return bond * s * (double)graph.spins[to * length + i] < 0 && dis(generator) < grow;
+        };
+        segment.assign(1, slice(generator));
+        for (int up = segment.front(); (int)segment.size() < height;) {
+            const int next = (up + 1) % height;
+            if (!joins(up, next)) break;
+            segment.push_back(up = next);
+        }
+        for (int down = segment.front(); (int)segment.size() < height;) {
+            const int prev = (down + height - 1) % height;
+            if (!joins(down, prev)) break;
+            segment.push_back(down = prev);
+        }
+
+        // The slices lie in different layers, their in-layer changes add up independently
+        classical.resize(segment.size());
+        double delta_E = 0.0;
+        for (int k = 0; k < (int)segment.size(); ++k) {
+            graph.getDifferences(segment[k] * length + i, classical[k]);
+            delta_E += classical[k];
+        }
+        if (!this->randomExec(std::min(1.0, std::exp(-delta_E)), [] () {})) continue;
+        ++accepts;
+        flipped += segment.size();
+        for (int k = 0; k < (int)segment.size(); ++k) {
+            const int layer = segment[k], index = layer * length + i;
+            graph.flipSpin(index);
+            this->layer_energy[layer] += classical[k];
+            if (this->best.flip(index, this->layer_energy[layer], graph.spins))
+                this->best_layer = layer;
+            this->order.flip(index, graph.spins[index]);
+        }
+    }
+    PROFILE_COUNT(profile::CLUSTER_MOVES, length);
+    PROFILE_COUNT(profile::CLUSTER_ACCEPTS, accepts);
+    PROFILE_COUNT(profile::CLUSTER_SPINS, flipped);
+    return;
+}
+
 // Anlr_SQA anneal
 double Anlr_SQA::anneal () {
-    this->graph.growLayer(this->params.layer_count - 1, this->params.gamma);
+    PROFILE_SCOPE(profile::ANNEAL);
+    this->startClock(); // The time budget includes growing the layers
+    this->classical_constant = this->graph.terms->constant;
+    {
+        PROFILE_SCOPE(profile::GROW_LAYER);
+        this->graph.growLayer(this->params.layer_count - 1, this->params.gamma);
+    }
     const double gamma0 = this->params.init_g, final_gamma = this->params.final_g;
     const int tau = this->params.tau;
+    this->params.schedule.check(gamma0, final_gamma);
 
-    for (int i = 0; i <= tau; ++i) {
-        const double gamma = gamma0 * (1 - ((double)i / tau)) + final_gamma * ((double)i / tau);
-        // const int length = this->graph.getSpinSize();
-        const int length   = graph.spins.size();
-        for (int j = 0; j < length; ++j) {
-            // Calculate the PI_accept
-            const double delta_E   = graph.getHamiltonianDifference(j);
-            const double PI_accept = std::min(1.0, std::exp(-delta_E));
+    if (!this->resume_spins.empty()) {
+        if (this->resume_spins.size() != this->graph.spins.size())
+            throw std::invalid_argument("Checkpoint does not match the SQA graph");
+        this->graph.spins = this->resume_spins;
+        if (this->start_step > 0) graph.updateGamma(this->resume_gamma);
+        this->resume_spins.clear();
+    }
+    if (this->best.getEnergy() < DBL_MAX) {
+        // Resumed, find the layer of the restored best configuration
+        const std::vector<double> e =
+            graph.getLayerEnergies(this->best.getBest(graph.spins), this->classical_constant);
+        this->best_layer = std::min_element(e.begin(), e.end()) - e.begin();
+    }
+    this->resetLayerEnergy();
 
-            // Flip the spin with probability PI_accept
-            this->randomExec(PI_accept, [&] () { graph.flipSpin(j); });
+    for (int i = this->start_step; this->running(i, tau); ++i) {
+        const double s     = this->progress(i, tau);
+        const double gamma = this->params.schedule.at(s, gamma0, final_gamma);
+        for (int k = 0; k < this->params.sweeps_per_step; ++k) {
+            this->sweep();
+            if (this->params.worldline) this->worldlineSweep();
+            this->order.sweep(gamma);
         }
         // Update the gamma: gamma, length, height
         graph.updateGamma(gamma);
+        if (this->observing()) this->observe(this->best.getEnergy(), this->params.sweeps_per_step);
 
 #ifdef USE_MPI
         deltaSGenFunc deltaS = [] (double& src_gamma, double& src_energy, double& target_gamma,
                                    double& target_energy) -> double {
             return (target_gamma - src_gamma) * (target_energy - src_energy);
         };
-        if (i % 8 == 0) {
+        if (i % EXCHANGE_INTERVAL == 0) {
             std::vector<Spin> config   = graph.getSpins();
             double vertical_energy_sum = this->getVerticalEnergySum();
-            swap(this->params.rank, gamma, vertical_energy_sum, config, deltaS);
+            if (swap(this->params.rank, gamma, vertical_energy_sum, config, deltaS)) {
+                this->best.freeze(graph.spins); // The swap is not journaled
+                this->graph.spins = config;
+                this->resetLayerEnergy();
+            }
         }
 #endif
+        this->stopped = this->agreeStop(i);
+        if (this->checkpointDue(i + 1))
+            this->saveCheckpoint(ANNEAL_FUNC::SQA, i + 1, gamma, graph.spins);
     }
 
-    return this->graph.getHamiltonianEnergy();
+    // The result is the best single layer, a classical configuration
+    const std::vector<double> e =
+        graph.getLayerEnergies(this->best.getBest(graph.spins), this->classical_constant);
+    return e[this->best_layer];
+}
+
+// Anlr_SQA measure, the layers are coupled as at gamma = init_g of a schedule and a sample after
+// every sweep past the thermalization takes the mean classical energy of the layers
+void Anlr_SQA::measure (Measurement& m, const int& thermalize, const int& sweeps) {
+    PROFILE_SCOPE(profile::ANNEAL);
+    this->startClock();
+    this->classical_constant = this->graph.terms->constant;
+    {
+        PROFILE_SCOPE(profile::GROW_LAYER);
+        this->graph.growLayer(this->params.layer_count - 1, this->params.gamma);
+    }
+    this->graph.updateGamma(this->params.init_g);
+    this->resetLayerEnergy();
+    const int height = this->layer_energy.size();
+    for (int i = 0; i < thermalize + sweeps && !this->stopping(); ++i) {
+        this->sweep();
+        if (this->params.worldline) this->worldlineSweep();
+        if (i < thermalize) continue;
+        double energy = 0.0;
+        for (const double& e : this->layer_energy)
+            energy += e / height;
+        m.add(energy, graph.spins, this->order);
+    }
+    return;
+}
+
+// Anlr_SQA polish, the Trotter edges are left out so the best layer descends classically
+double Anlr_SQA::polish () {
+    PROFILE_SCOPE(profile::POLISH);
+    std::vector<Spin> trotter = this->best.getBest(graph.spins);
+    const int length          = graph.getLength();
+    [[maybe_unused]] const int flips =
+        graph.descend(trotter, this->best_layer * length, (this->best_layer + 1) * length);
+    PROFILE_COUNT(profile::POLISH_FLIPS, flips);
+    const double energy =
+        graph.getLayerEnergies(trotter, this->classical_constant)[this->best_layer];
+    this->best.restore(energy, trotter);
+    return energy;
+}
+
+// Anlr_SQA getBestSpins
+std::vector<Spin> Anlr_SQA::getBestSpins () const {
+    const std::vector<Spin> trotter = this->best.getBest(graph.spins);
+    const int length                = graph.getLength();
+    return std::vector<Spin>(trotter.begin() + this->best_layer * length,
+                             trotter.begin() + (this->best_layer + 1) * length);
+}
+
+// Anlr_SQA resume, the spins are restored in anneal once the layers exist
+void Anlr_SQA::resume (const Checkpoint& c) {
+    if (c.func != ANNEAL_FUNC::SQA) throw std::invalid_argument("Checkpoint is not an SQA run");
+    this->resume_spins = c.spins;
+    this->resume_gamma = c.param;
+    this->restoreCheckpoint(c);
+    return;
 }
 
 // Anlr_SQA getHamiltonianEnergy
@@ -170,21 +404,14 @@ double Anlr_SQA::getHamiltonianEnergy () const {
 // Anlr_SQA getVerticalEnergySum
 double Anlr_SQA::getVerticalEnergySum () const {
     const int length = this->graph.getLength();
-    std::vector<double> list_of_energy(length, 0.0);
+    const int total  = this->graph.spins.size();
+    double sum       = 0.0;
 
-    for (int i = 0; i < length; ++i) {
-        const int self_idx = this->graph.adj_list[i]->val;
-        AdjNode *tmp       = this->graph.adj_list[i];
-        // int current_layer = 0;
-
-        // \sum_{i=1}^L { \sum_{l=1}^{L_tau} { s_i^l * s_i^{l+1} } }
-        while (tmp->val != self_idx) {
-            const int layer_up_idx = (tmp->val + length) % (length * this->params.layer_count);
-            list_of_energy[i] +=
-                (double)this->graph.spins[tmp->val] * (double)this->graph.spins[layer_up_idx];
-            // ++current_layer;
-        }
+    // \sum_{i=1}^L { \sum_{l=1}^{L_tau} { s_i^l * s_i^{l+1} } }
+    for (int i = 0; i < total; ++i) {
+        const int layer_up_idx = (i + length) % total;
+        sum += (double)this->graph.spins[i] * (double)this->graph.spins[layer_up_idx];
     }
 
-    return std::accumulate(list_of_energy.begin(), list_of_energy.end(), 0.0);
+    return sum;
 }
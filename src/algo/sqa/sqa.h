@@ -2,15 +2,21 @@
 #define _SQA_H_
 
 #include "../../annealer/Annealer.h"
+#include "../../annealer/Measurement.h"
+#include "../../annealer/Schedule.h"
+#include "../../include/AnnealFunc.h"
 #include <fstream>
 
 struct Params_SQA {
-    int rank        = 0;
-    double init_g   = 0.2;
-    double final_g  = 0.0;
-    int tau         = 1000;
-    double gamma    = 0.2;
-    int layer_count = 8;
+    int rank            = 0;
+    double init_g       = 0.2;
+    double final_g      = 0.0;
+    int tau             = 1000;
+    double gamma        = 0.2;
+    int layer_count     = 8;
+    Schedule schedule;       // Gamma from init_g to final_g over the tau steps
+    int sweeps_per_step = 1;     // Sweeps at every gamma of the schedule
+    bool worldline      = false; // Worldline cluster moves after every sweep
 };
 
 class Anlr_SQA : public Annealer {
@@ -23,9 +29,23 @@ class Anlr_SQA : public Annealer {
         Grph_SQA(const Graph&);
         void updateGamma(const double&);
         void growLayer(const int&, const double&);
+        double getDifferences(const int&, double&); // Trotter delta E, sets the in-layer delta E
+        std::vector<double> getLayerEnergies(const std::vector<Spin>&,
+                                             const double&) const; // spins, classical constant
+        double getTrotterWeight() const; // Coupling between consecutive slices of a spin
     };
     Grph_SQA graph;
     Params_SQA params;
+    std::vector<Spin> resume_spins; // Trotter configuration to restore once the layers are grown
+    double resume_gamma = 0.0;
+    double classical_constant = 0.0;  // Constant term of a single layer
+    std::vector<double> layer_energy; // Classical energy of every layer, tracked by the sweeps
+    int best_layer = 0;               // Layer of the best configuration
+
+    void resetLayerEnergy(); // Recount layer_energy and order after a change that is not a sweep
+
+    void sweep();          // One Metropolis sweep over every layer
+    void worldlineSweep(); // One worldline cluster move per classical spin
 
   public:
     Anlr_SQA();
@@ -36,6 +56,10 @@ class Anlr_SQA : public Annealer {
     // Virtual functions
     double anneal();
 
+    double polish(); // Steepest descent of the best layer, returns its energy
+    void measure(Measurement&, const int&,
+                 const int&); // Equilibrium at init_g: thermalize sweeps, then sampled sweeps
+
     // Reexported functions from Graph
     int getLength() const;
     int getHeight() const;
@@ -49,6 +73,8 @@ class Anlr_SQA : public Annealer {
 
     // SQA functions
     void growLayer(const int&, const double&);
+    std::vector<Spin> getBestSpins() const; // Lowest energy layer seen, one spin per classical spin
+    void resume(const Checkpoint&); // Continue from a checkpoint of the same graph
 
     // MPI functions (SQA)
     double getVerticalEnergySum() const;
@@ -0,0 +1,303 @@
+#include "tabu.h"
+#include "../../profile/Profile.h"
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+// Grph_TABU Constructor
+Anlr_TABU::Grph_TABU::Grph_TABU () : Graph() {
+    return;
+}
+Anlr_TABU::Grph_TABU::Grph_TABU (const Graph& g) : Graph(g) {
+    return;
+}
+
+// Grph_TABU getDeltas, self loops are constant and never change the energy
+std::vector<double> Anlr_TABU::Grph_TABU::getDeltas (const std::vector<Spin>& config) const {
+    std::vector<double> delta(config.size(), 0.0);
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i)
+        for (AdjNode *tmp = terms->adj_list[i]; tmp != nullptr; tmp = tmp->next)
+            if (tmp->val != i) delta[i] += tmp->weight * (double)config[tmp->val];
+    for (auto const& it : terms->constant_map)
+        delta[it.first] += it.second;
+    for (int i = 0; i < (int)config.size(); ++i)
+        delta[i] *= -2.0 * (double)config[i];
+    return delta;
+}
+
+// Anlr_TABU Constructor
+Anlr_TABU::Anlr_TABU () : Annealer(0), graph() {
+    return;
+}
+Anlr_TABU::Anlr_TABU (const Graph& g, const Params_TABU& p)
+    : Annealer(p.rank), graph(g), params(p) {
+    return;
+}
+
+// Anlr_TABU getParams
+Params_TABU Anlr_TABU::getParams () const {
+    return this->params;
+}
+
+// Anlr_TABU Reexported functions from Graph
+int Anlr_TABU::getLength () const {
+    return this->graph.getLength();
+}
+int Anlr_TABU::getHeight () const {
+    return this->graph.getHeight();
+}
+std::vector<Spin> Anlr_TABU::getSpins () const {
+    return this->graph.getSpins();
+}
+double Anlr_TABU::getHamiltonianEnergy () const {
+    return this->graph.getHamiltonianEnergy();
+}
+
+void Anlr_TABU::setSpins (const int index, const int value) {
+    this->graph.setSpin(index, value);
+    return;
+}
+
+// DeltaHeap, lowest delta first, then the tag and the index so the order is total
+bool Anlr_TABU::DeltaHeap::Entry::operator< (const Entry& other) const {
+    if (this->delta != other.delta) return this->delta < other.delta;
+    if (this->tag != other.tag) return this->tag < other.tag;
+    return this->spin < other.spin;
+}
+
+void Anlr_TABU::DeltaHeap::reset (const int& spins) {
+    this->heap.clear();
+    this->heap.reserve(spins);
+    this->position.assign(spins, -1);
+    return;
+}
+
+bool Anlr_TABU::DeltaHeap::empty () const {
+    return this->heap.empty();
+}
+
+bool Anlr_TABU::DeltaHeap::contains (const int& spin) const {
+    return this->position[spin] >= 0;
+}
+
+int Anlr_TABU::DeltaHeap::top () const {
+    return this->heap.front().spin;
+}
+
+double Anlr_TABU::DeltaHeap::topDelta () const {
+    return this->heap.front().delta;
+}
+
+void Anlr_TABU::DeltaHeap::place (const int& index, const Entry& entry) {
+    this->heap[index]          = entry;
+    this->position[entry.spin] = index;
+    return;
+}
+
+void Anlr_TABU::DeltaHeap::up (int index) {
+    const Entry entry = this->heap[index];
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (!(entry < this->heap[parent])) break;
+        this->place(index, this->heap[parent]);
+        index = parent;
+    }
+    this->place(index, entry);
+    return;
+}
+
+void Anlr_TABU::DeltaHeap::down (int index) {
+    const Entry entry = this->heap[index];
+    const int size    = this->heap.size();
+    while (2 * index + 1 < size) {
+        int child = 2 * index + 1;
+        if (child + 1 < size && this->heap[child + 1] < this->heap[child]) ++child;
+        if (!(this->heap[child] < entry)) break;
+        this->place(index, this->heap[child]);
+        index = child;
+    }
+    this->place(index, entry);
+    return;
+}
+
+void Anlr_TABU::DeltaHeap::push (const int& spin, const double& delta, const uint32_t& tag) {
+    this->heap.push_back(Entry { delta, tag, spin });
+    this->up(this->heap.size() - 1);
+    return;
+}
+
+void Anlr_TABU::DeltaHeap::update (const int& spin, const double& delta, const uint32_t& tag) {
+    const int index   = this->position[spin];
+    const Entry old   = this->heap[index];
+    this->heap[index] = Entry { delta, tag, spin };
+    if (this->heap[index] < old) this->up(index);
+    else this->down(index);
+    return;
+}
+
+void Anlr_TABU::DeltaHeap::erase (const int& spin) {
+    const int index      = this->position[spin];
+    const Entry last     = this->heap.back();
+    this->position[spin] = -1;
+    this->heap.pop_back();
+    if (index == (int)this->heap.size()) return;
+    const Entry old = this->heap[index];
+    this->place(index, last);
+    if (last < old) this->up(index);
+    else this->down(index);
+    return;
+}
+
+// Anlr_TABU start, every spin of a new walk is free
+void Anlr_TABU::start (Walk& w) const {
+    const int length = w.spins.size();
+    w.free.reset(length);
+    w.tabu.reset(length);
+    w.expiry.clear();
+    for (int j = 0; j < length; ++j)
+        w.free.push(j, w.delta[j], w.generator());
+    return;
+}
+
+// Anlr_TABU move, flip the best admissible spin: the top of the free spins, or the top of the
+// tabu ones when it reaches a new best energy
+void Anlr_TABU::move (Walk& w, const int& tenure) const {
+    // Release the spins whose tenure ended, an entry is stale if the spin was flipped again
+    while (!w.expiry.empty() && w.expiry.front().first <= w.moves) {
+        const int j = w.expiry.front().second;
+        if (w.tabu_till[j] == w.expiry.front().first) {
+            w.tabu.erase(j);
+            w.free.push(j, w.delta[j], w.generator());
+        }
+        w.expiry.pop_front();
+    }
+
+    int pick = w.free.empty() ? -1 : w.free.top();
+    // Aspiration: a tabu spin may flip when it reaches a new best energy
+    if (!w.tabu.empty() && w.energy + w.tabu.topDelta() < w.best.getEnergy()
+        && (pick < 0 || w.tabu.topDelta() < w.delta[pick]))
+        pick = w.tabu.top();
+    ++w.moves;
+    if (pick < 0) return; // Every spin is tabu
+
+    const double pick_delta = w.delta[pick];
+    const double old_spin   = (double)w.spins[pick];
+    w.spins[pick]           = (w.spins[pick] == UP) ? DOWN : UP;
+    w.energy += pick_delta;
+    w.delta[pick]     = -pick_delta;
+    w.tabu_till[pick] = w.moves + tenure;
+    if (w.free.contains(pick)) {
+        w.free.erase(pick);
+        w.tabu.push(pick, w.delta[pick], w.generator());
+    } else {
+        w.tabu.update(pick, w.delta[pick], w.generator());
+    }
+    w.expiry.emplace_back(w.tabu_till[pick], pick);
+    // delta E_j = -2 s_j (w s_pick + ...), the w s_pick term changed sign
+    AdjNode *tmp = pick < (int)graph.terms->adj_list.size() ? graph.terms->adj_list[pick] : nullptr;
+    for (; tmp != nullptr; tmp = tmp->next) {
+        const int j = tmp->val;
+        if (j == pick) continue;
+        w.delta[j] += 4.0 * tmp->weight * (double)w.spins[j] * old_spin;
+        (w.free.contains(j) ? w.free : w.tabu).update(j, w.delta[j], w.generator());
+    }
+    w.best.flip(pick, w.energy, w.spins);
+    return;
+}
+
+// Anlr_TABU search, one start. The starts run in parallel so they keep their own stagnation
+// count and share the target through quit.
+void Anlr_TABU::search (Walk& w, const double& deadline, std::atomic<bool>& quit) const {
+    const int length    = w.spins.size();
+    const int tenure    = this->params.tenure > 0 ? this->params.tenure
+                                                  : std::max(1, std::min(20, length / 4));
+    const StopPolicy& p = this->stop_policy;
+    double stall_best   = DBL_MAX;
+    int stall_steps     = 0;
+    for (int i = 0; i < this->params.tau || p.time_limit > 0.0; ++i) {
+        if (quit.load() || (this->cancel_flag && this->cancel_flag->load())) break;
+        if (deadline > 0.0 && this->elapsed() >= deadline) break;
+        {
+            PROFILE_SCOPE(profile::SWEEP);
+            for (int k = 0; k < length; ++k)
+                this->move(w, tenure);
+        }
+        PROFILE_COUNT(profile::PROPOSALS, length);
+        PROFILE_COUNT(profile::ACCEPTS, length);
+
+        const double energy = w.best.getEnergy();
+        if (energy < stall_best) {
+            stall_best  = energy;
+            stall_steps = 0;
+        } else if (p.stagnation > 0 && ++stall_steps >= p.stagnation) {
+            break;
+        }
+        if (p.has_target && energy <= p.target_energy) {
+            quit.store(true);
+            if (this->cancel_flag) this->cancel_flag->store(true); // Cancel the other replicas
+            break;
+        }
+    }
+    return;
+}
+
+// Anlr_TABU anneal
+double Anlr_TABU::anneal () {
+    PROFILE_SCOPE(profile::ANNEAL);
+    this->startClock();
+    const int length  = graph.spins.size();
+    const int starts  = std::max(1, this->params.starts);
+    const int threads = std::max(1, std::min(this->params.threads, starts));
+
+    // Seed every start from the annealer generator, bounded by tau the result does not depend on
+    // the thread count
+    std::vector<Walk> walks(starts);
+    std::bernoulli_distribution coin(0.5);
+    for (int k = 0; k < starts; ++k) {
+        Walk& w = walks[k];
+        w.generator.seed(this->generator());
+        w.spins = graph.spins; // The first start keeps the given configuration
+        if (k > 0)
+            for (int i = 0; i < length; ++i)
+                w.spins[i] = coin(w.generator) ? UP : DOWN;
+        w.delta = graph.getDeltas(w.spins);
+        w.tabu_till.assign(length, 0);
+        this->start(w);
+        std::swap(graph.spins, w.spins);
+        w.energy = graph.getHamiltonianEnergy();
+        std::swap(graph.spins, w.spins);
+        w.best.update(w.energy);
+    }
+
+    // Thread t runs starts t, t + threads, ..., each with its share of the time budget
+    const int rounds   = (starts + threads - 1) / threads;
+    const double slice = this->stop_policy.time_limit / rounds;
+    std::atomic<bool> quit(false);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] () {
+            for (int k = t; k < starts; k += threads)
+                this->search(walks[k], slice * (k / threads + 1), quit);
+        });
+    for (std::thread& worker : workers)
+        worker.join();
+
+    // Lowest energy of every start, the first one on ties
+    int pick = 0;
+    for (int k = 1; k < starts; ++k)
+        if (walks[k].best.getEnergy() < walks[pick].best.getEnergy()) pick = k;
+    this->graph.spins = walks[pick].best.getBest(walks[pick].spins);
+    const double energy = graph.getHamiltonianEnergy();
+    this->best.update(energy);
+    return energy;
+}
+
+// Anlr_TABU polish
+double Anlr_TABU::polish () {
+    PROFILE_SCOPE(profile::POLISH);
+    [[maybe_unused]] const int flips = graph.descend(graph.spins, 0, graph.spins.size());
+    PROFILE_COUNT(profile::POLISH_FLIPS, flips);
+    const double energy = graph.getHamiltonianEnergy();
+    this->best.update(energy);
+    return energy;
+}
@@ -0,0 +1,105 @@
+#ifndef _TABU_H_
+#define _TABU_H_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+#include "../../annealer/Annealer.h"
+#include "../../annealer/BestTracker.h"
+#include "../../include/AnnealFunc.h"
+
+struct Params_TABU {
+    int rank    = 0;
+    int tau     = 1000; // Steps per start, a step makes as many moves as there are spins
+    int tenure  = 0;    // Moves a flipped spin stays tabu, 0 for min(20, spins / 4)
+    int starts  = 1;    // Independent starts, the result is the best of them
+    int threads = 1;    // Threads the starts are spread over
+};
+
+/*
+ * 1-flip tabu search: every move flips the spin with the lowest delta E that is not tabu, or a
+ * tabu one if it reaches a new best energy (aspiration). The delta E of every spin is cached and
+ * patched along the edges of each flip. The spins sit in two indexed heaps, the free ones and the
+ * tabu ones, so a move reads the two tops and costs O(degree log N) instead of a scan of every
+ * spin. Ties are broken by a random tag drawn whenever the delta of a spin changes.
+ */
+class Anlr_TABU : public Annealer {
+  private:
+    class Grph_TABU : public Graph {
+        friend class Anlr_TABU;
+
+      public:
+        Grph_TABU();
+        Grph_TABU(const Graph&);
+        std::vector<double> getDeltas(const std::vector<Spin>&) const; // Delta E of every flip
+    };
+    // Min-heap of spins by (delta E, tag, index) with the position of every spin in it, so the
+    // key of a spin changes in O(log N)
+    class DeltaHeap {
+      private:
+        struct Entry {
+            double delta;
+            uint32_t tag;
+            int spin;
+            bool operator<(const Entry&) const;
+        };
+        std::vector<Entry> heap;
+        std::vector<int> position; // Index in heap of every spin, -1 when it is not in this heap
+
+        void place(const int&, const Entry&); // Store at a heap index
+        void up(int);
+        void down(int);
+
+      public:
+        void reset(const int&); // Empty, for the given number of spins
+        bool empty() const;
+        bool contains(const int&) const;
+        int top() const;
+        double topDelta() const;
+        void push(const int&, const double&, const uint32_t&);   // spin, delta, tag
+        void update(const int&, const double&, const uint32_t&); // spin, delta, tag
+        void erase(const int&);
+    };
+    // One start: its own configuration, move values and generator
+    struct Walk {
+        std::vector<Spin> spins;
+        std::vector<double> delta;   // Delta E of flipping each spin
+        std::vector<long> tabu_till; // Move from which each spin may flip again
+        DeltaHeap free, tabu;        // Every spin is in one of them
+        std::deque<std::pair<long, int> > expiry; // (tabu_till, spin) in flip order
+        std::mt19937 generator;
+        double energy = 0.0;
+        long moves    = 0;
+        BestTracker best;
+    };
+    Grph_TABU graph;
+    Params_TABU params;
+
+    void start(Walk&) const;            // Heaps of the deltas of a new walk
+    void move(Walk&, const int&) const; // tenure
+    void search(Walk&, const double&,
+                std::atomic<bool>&) const; // Run a start until its deadline or quit is set
+
+  public:
+    Anlr_TABU();
+    Anlr_TABU(const Graph&, const Params_TABU&);
+    Params_TABU getParams() const;
+
+    // Virtual functions
+    double anneal();
+
+    double polish(); // Steepest descent of the result, returns its energy
+
+    // Reexported functions from Graph
+    int getLength() const;
+    int getHeight() const;
+    std::vector<Spin> getSpins() const;
+    double getHamiltonianEnergy() const;
+
+    // Graph manipulator
+    void setSpins(const int index, const int value);
+};
+
+#endif
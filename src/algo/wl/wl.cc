@@ -0,0 +1,353 @@
+#include "wl.h"
+#include "../../include/Parallel.h"
+#include "../../profile/Profile.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+// Grph_WL Constructor
+Anlr_WL::Grph_WL::Grph_WL () : Graph() {
+    return;
+}
+Anlr_WL::Grph_WL::Grph_WL (const Graph& g) : Graph(g) {
+    return;
+}
+
+// Anlr_WL Constructor, the couplings are copied to integer arrays. Self loops are constant.
+Anlr_WL::Anlr_WL () : Annealer(0), graph() {
+    return;
+}
+Anlr_WL::Anlr_WL (const Graph& g, const Params_WL& p) : Annealer(p.rank), graph(g), params(p) {
+    auto integer = [] (const double& value) {
+        if (value != std::nearbyint(value))
+            throw std::invalid_argument("--func wl needs integer couplings and fields, not " +
+                                        std::to_string(value));
+        return (int64_t)std::nearbyint(value);
+    };
+    const int n = graph.spins.size();
+    int64_t gcd = 0;
+    this->constant = graph.terms->constant;
+    this->offsets.assign(n + 1, 0);
+    this->fields.assign(n, 0);
+    for (int i = 0; i < n; ++i) {
+        if (i < (int)graph.terms->adj_list.size())
+            for (AdjNode *tmp = graph.terms->adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+                if (tmp->val == i) {
+                    this->constant += tmp->weight;
+                    continue;
+                }
+                this->neighbors.push_back(tmp->val);
+                this->weights.push_back(integer(tmp->weight));
+                gcd = std::gcd(gcd, this->weights.back());
+            }
+        this->offsets[i + 1] = this->neighbors.size();
+    }
+    for (auto const& it : graph.terms->constant_map) {
+        this->fields[it.first] = integer(it.second);
+        gcd                    = std::gcd(gcd, this->fields[it.first]);
+    }
+    if (gcd == 0) throw std::invalid_argument("--func wl needs a graph with couplings or fields");
+    // A flip changes the energy by 2 s_i (sum_j w_ij s_j + h_i), a multiple of 2 gcd
+    this->step = 2 * gcd;
+    return;
+}
+
+// Anlr_WL getParams
+Params_WL Anlr_WL::getParams () const {
+    return this->params;
+}
+
+// Anlr_WL setFields
+void Anlr_WL::setFields (Walker& w) const {
+    const int n = w.spins.size();
+    w.fields    = this->fields;
+    int64_t sum = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int k = this->offsets[i]; k < this->offsets[i + 1]; ++k)
+            w.fields[i] += this->weights[k] * w.spins[this->neighbors[k]];
+        sum += w.spins[i] * (w.fields[i] + this->fields[i]);
+    }
+    w.energy = sum / 2; // Every coupling twice, every field twice
+    return;
+}
+
+// Anlr_WL flip, patches the fields of the neighbors
+void Anlr_WL::flip (Walker& w, const int& i) const {
+    w.energy += this->difference(w, i);
+    w.spins[i] = (w.spins[i] == UP) ? DOWN : UP;
+    const int64_t change = 2 * (int64_t)w.spins[i];
+    for (int k = this->offsets[i]; k < this->offsets[i + 1]; ++k)
+        w.fields[this->neighbors[k]] += change * this->weights[k];
+    return;
+}
+
+// Anlr_WL extreme, a Metropolis anneal of sign * E from twice the largest coupling or field down
+// to 0 over tau sweeps, from a random configuration
+Anlr_WL::Walker Anlr_WL::extreme (const int& sign) {
+    const int n = this->graph.spins.size();
+    int64_t largest = 0;
+    for (const int64_t& w : this->weights)
+        largest = std::max(largest, std::abs(w));
+    for (const int64_t& h : this->fields)
+        largest = std::max(largest, std::abs(h));
+    const double T0 = 2.0 * largest;
+
+    Walker w;
+    std::uniform_int_distribution<int> coin(0, 1);
+    w.spins.resize(n);
+    for (Spin& s : w.spins)
+        s = coin(this->generator) ? UP : DOWN;
+    this->setFields(w);
+    BestTracker lowest;
+    lowest.update(sign * w.energy);
+    for (int k = 1; k <= this->params.tau; ++k) {
+        const double T = T0 * (1.0 - (double)k / this->params.tau); // The last sweep is greedy
+        for (int i = 0; i < n; ++i)
+            if (this->randomExec(acceptance(sign * this->difference(w, i), T),
+                                 [&] () { this->flip(w, i); }))
+                lowest.flip(i, sign * w.energy, w.spins);
+    }
+    w.spins = lowest.getBest(w.spins);
+    this->setFields(w);
+    return w;
+}
+
+// Anlr_WL approach, flips that do not move away from the window until the walker is in it. The
+// walkers start from the lowest (highest) configuration and go up (down), so they rarely stall.
+void Anlr_WL::approach (Walker& w) const {
+    const int n = w.spins.size();
+    std::uniform_int_distribution<int> site(0, n - 1);
+    auto distance = [&] (const int64_t& e) -> int64_t {
+        return e < w.low ? w.low - e : e > w.high ? e - w.high : 0;
+    };
+    for (long tries = 0; distance(w.energy) > 0; ++tries) {
+        if (tries > 1000L * n)
+            throw std::runtime_error("A Wang-Landau walker did not reach its window");
+        const int i = site(w.generator);
+        if (distance(w.energy + this->difference(w, i)) <= distance(w.energy)) this->flip(w, i);
+    }
+    return;
+}
+
+// Anlr_WL sweeps, a move proposes a random spin and is accepted with min(1, g(E) / g(E')) when it
+// stays in the window. ln g and the histogram of the energy after every move are updated.
+void Anlr_WL::sweeps (Walker& w, const int& count) const {
+    PROFILE_SCOPE(profile::SWEEP);
+    const int n = w.spins.size();
+    std::uniform_int_distribution<int> site(0, n - 1);
+    std::uniform_real_distribution<double> dis(0.0, 1.0);
+    [[maybe_unused]] long accepts = 0;
+    int bin = (w.energy - w.low) / this->step;
+    for (long move = 0; move < (long)count * n; ++move) {
+        const int i        = site(w.generator);
+        const int64_t next = w.energy + this->difference(w, i);
+        w.lowest           = std::min(w.lowest, next);
+        if (next >= w.low && next <= w.high) {
+            const int to       = (next - w.low) / this->step;
+            const double ratio = w.ln_g[bin] - w.ln_g[to];
+            if (ratio >= 0.0 || dis(w.generator) < std::exp(ratio)) {
+                this->flip(w, i);
+                bin = to;
+                ++accepts;
+            }
+        }
+        w.ln_g[bin] += w.ln_f;
+        ++w.histogram[bin];
+        w.visited[bin] = true;
+    }
+    w.moves += (long)count * n;
+    PROFILE_COUNT(profile::PROPOSALS, (long)count * n);
+    PROFILE_COUNT(profile::ACCEPTS, accepts);
+    return;
+}
+
+// Anlr_WL exchange, the walkers swap configurations when both energies lie in both windows, with
+// probability min(1, g_k(E_k) g_k+1(E_k+1) / (g_k(E_k+1) g_k+1(E_k)))
+void Anlr_WL::exchange (const int& k) {
+    Walker &a = this->walkers[k], &b = this->walkers[k + 1];
+    if (a.energy < b.low || a.energy > b.high || b.energy < a.low || b.energy > a.high) return;
+    PROFILE_COUNT(profile::EXCHANGES, 1);
+    auto ln_g = [&] (const Walker& w, const int64_t& e) {
+        return w.ln_g[(e - w.low) / this->step];
+    };
+    const double ratio =
+        ln_g(a, a.energy) - ln_g(a, b.energy) + ln_g(b, b.energy) - ln_g(b, a.energy);
+    if (ratio < 0.0 && !this->randomExec(std::exp(ratio), [] () {})) return;
+    std::swap(a.spins, b.spins);
+    std::swap(a.fields, b.fields);
+    std::swap(a.energy, b.energy);
+    PROFILE_COUNT(profile::EXCHANGE_ACCEPTS, 1);
+    return;
+}
+
+// Anlr_WL flat, over the bins the walker ever visited, once the stage saw WL_MIN_VISITS per bin
+bool Anlr_WL::flat (const Walker& w) const {
+    long total = 0, lowest = LONG_MAX;
+    int bins = 0;
+    for (size_t b = 0; b < w.histogram.size(); ++b) {
+        if (!w.visited[b]) continue;
+        total += w.histogram[b];
+        lowest = std::min(lowest, w.histogram[b]);
+        ++bins;
+    }
+    return bins > 0 && total >= (long)WL_MIN_VISITS * bins &&
+           lowest >= this->params.flatness * total / bins;
+}
+
+// Anlr_WL refine, halve ln f on a flat histogram until it reaches 1/t (t in proposals per bin of
+// the window), then follow 1/t
+void Anlr_WL::refine (Walker& w) const {
+    const double inverse_time = (double)w.ln_g.size() / w.moves;
+    if (w.inverse) {
+        w.ln_f = inverse_time;
+        return;
+    }
+    if (!this->flat(w)) return;
+    w.ln_f /= 2;
+    std::fill(w.histogram.begin(), w.histogram.end(), 0);
+    if (w.ln_f > inverse_time) return;
+    w.inverse = true;
+    w.ln_f    = inverse_time;
+    return;
+}
+
+// Anlr_WL join, ln g of a window is shifted to agree with the windows below it at the shared bin
+// where the slopes of the two agree best, and replaces them above that bin
+void Anlr_WL::join () {
+    const int bins = this->ends.back() + 1;
+    std::vector<double> ln_g(bins, 0.0);
+    std::vector<bool> known(bins, false);
+    for (int k = 0; k < (int)this->walkers.size(); ++k) {
+        const Walker& w = this->walkers[k];
+        const int s     = this->starts[k];
+        int joint       = s - 1;
+        double shift    = 0.0;
+        if (k > 0) {
+            std::vector<int> shared; // Bins of the overlap both sides visited
+            for (int b = s; b <= this->ends[k - 1]; ++b)
+                if (known[b] && w.visited[b - s]) shared.push_back(b);
+            if (shared.empty())
+                throw std::runtime_error("Wang-Landau windows " + std::to_string(k - 1) + " and " +
+                                         std::to_string(k) + " share no visited energy");
+            joint            = shared[0];
+            double best_diff = DBL_MAX;
+            for (int j = 0; j + 1 < (int)shared.size(); ++j) {
+                const int a = shared[j], c = shared[j + 1];
+                const double diff =
+                    std::abs((ln_g[c] - ln_g[a]) - (w.ln_g[c - s] - w.ln_g[a - s]));
+                if (diff < best_diff) {
+                    best_diff = diff;
+                    joint     = a;
+                }
+            }
+            shift = ln_g[joint] - w.ln_g[joint - s];
+        }
+        for (int b = joint + 1; b <= this->ends[k]; ++b) {
+            known[b] = w.visited[b - s];
+            ln_g[b]  = w.ln_g[b - s] + shift;
+        }
+    }
+
+    // Normalized to the 2^N configurations
+    double top = -DBL_MAX, sum = 0.0;
+    for (int b = 0; b < bins; ++b)
+        if (known[b]) top = std::max(top, ln_g[b]);
+    for (int b = 0; b < bins; ++b)
+        if (known[b]) sum += std::exp(ln_g[b] - top);
+    const double norm = this->graph.spins.size() * std::log(2.0) - top - std::log(sum);
+    this->density.clear();
+    for (int b = 0; b < bins; ++b)
+        if (known[b])
+            this->density.push_back(DensityPoint {
+                (double)(this->low + b * this->step) + this->constant, ln_g[b] + norm });
+    return;
+}
+
+// Anlr_WL anneal
+double Anlr_WL::anneal () {
+    PROFILE_SCOPE(profile::ANNEAL);
+    this->startClock();
+    const Walker bottom = this->extreme(1), top = this->extreme(-1);
+    this->low            = bottom.energy;
+    const int64_t bins   = (top.energy - bottom.energy) / this->step + 1;
+    const int count      = this->params.windows;
+    if (bins > (1 << 24))
+        throw std::invalid_argument("--func wl would need " + std::to_string(bins) +
+                                    " energy bins, the couplings are too fine");
+    if (bins < 2 * count)
+        throw std::invalid_argument("--windows " + std::to_string(count) + " for " +
+                                    std::to_string(bins) + " energy bins");
+
+    // Windows of equal width, each sharing WL_OVERLAP of it with the next one
+    const double width = bins / (1 + (count - 1) * (1 - WL_OVERLAP));
+    this->starts.resize(count);
+    this->ends.resize(count);
+    this->walkers.clear();
+    for (int k = 0; k < count; ++k) {
+        this->starts[k] = std::lround(k * width * (1 - WL_OVERLAP));
+        this->ends[k]   = std::min<int64_t>(bins - 1, std::lround(this->starts[k] + width) - 1);
+        if (k == count - 1) this->ends[k] = bins - 1;
+        // Walkers of the lower half go up from the lowest configuration, the others down
+        Walker w = this->starts[k] + this->ends[k] < bins ? bottom : top;
+        const int size = this->ends[k] - this->starts[k] + 1;
+        w.low          = this->low + this->starts[k] * this->step;
+        w.high         = this->low + this->ends[k] * this->step;
+        w.ln_g.assign(size, 0.0);
+        w.histogram.assign(size, 0);
+        w.visited.assign(size, false);
+        w.generator.seed(this->generator());
+        this->approach(w);
+        this->walkers.push_back(std::move(w));
+    }
+
+    auto done = [&] (const Walker& w) { return w.ln_f < this->params.final_lnf; };
+    const int threads = std::min(this->params.threads, count);
+    for (int parity = 0;; parity ^= 1) {
+        parallelFor(threads, count, [&] (int begin, int end) {
+            for (int k = begin; k < end; ++k)
+                if (!done(this->walkers[k])) this->sweeps(this->walkers[k], WL_BLOCK);
+        });
+        for (int k = parity; k + 1 < count; k += 2)
+            if (!done(this->walkers[k]) && !done(this->walkers[k + 1])) this->exchange(k);
+        bool finished = true;
+        for (Walker& w : this->walkers) {
+            if (!done(w)) this->refine(w);
+            finished = finished && done(w);
+        }
+        if (this->stop_policy.time_limit > 0.0 && this->elapsed() >= this->stop_policy.time_limit)
+            this->stop_requested = true;
+        if (finished || this->stopping()) break;
+    }
+    this->join();
+
+    if (this->walkers.front().lowest < this->low)
+        std::cerr << "Wang-Landau: energy " << this->walkers.front().lowest + this->constant
+                  << " lies below the range found, raise --tau" << std::endl;
+    this->graph.spins = bottom.spins;
+    this->best.update(bottom.energy + this->constant);
+    return bottom.energy + this->constant;
+}
+
+// Anlr_WL getDensity
+std::vector<DensityPoint> Anlr_WL::getDensity () const {
+    return this->density;
+}
+
+// Reexported functions from Graph
+int Anlr_WL::getLength () const {
+    return this->graph.getLength();
+}
+int Anlr_WL::getHeight () const {
+    return this->graph.getHeight();
+}
+std::vector<Spin> Anlr_WL::getSpins () const {
+    return this->graph.getSpins();
+}
+double Anlr_WL::getHamiltonianEnergy () const {
+    return this->graph.getHamiltonianEnergy();
+}
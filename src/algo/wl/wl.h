@@ -0,0 +1,108 @@
+#ifndef _WL_H_
+#define _WL_H_
+
+#include <cstdint>
+#include <random>
+
+#include "../../annealer/Annealer.h"
+#include "../../include/AnnealFunc.h"
+
+struct Params_WL {
+    int rank         = 0;
+    int tau          = 1000; // Sweeps of each of the anneals that find the energy range
+    int windows      = 1;    // Overlapping energy windows, one walker each
+    double flatness  = 0.8;  // A histogram is flat once its lowest bin reaches this of its mean
+    double final_lnf = 1e-6; // ln f at which a window is done
+    int threads      = 1;    // Threads the windows are spread over
+};
+
+const double WL_OVERLAP = 0.75; // Fraction of a window shared with its neighbor
+const int WL_BLOCK      = 10;   // Sweeps between flatness checks and replica exchanges
+const int WL_MIN_VISITS = 100;  // Mean visits per bin of a stage before its flatness is tested
+
+// ln g of an energy of the graph
+struct DensityPoint {
+    double energy;
+    double ln_g;
+};
+
+/*
+ * Wang-Landau sampling of the density of states g(E). The couplings and fields must be integers,
+ * so every energy is a multiple of twice their gcd away from the lowest possible one and indexes
+ * a histogram bin. The local field of every spin is kept up to date, so a proposal costs O(1) and
+ * an accepted flip O(degree). Two anneals (of E and of -E) find the range of energies; it is
+ * split into overlapping windows with a walker each, walkers of neighboring windows exchange
+ * configurations every WL_BLOCK sweeps (replica exchange Wang-Landau). A stage of ln f ends on a
+ * flat histogram of at least WL_MIN_VISITS per bin; once ln f falls below bins / proposals of
+ * the window it follows that 1/t instead (Belardinelli-Pereyra), as halving it further only
+ * freezes the error of the early stages. The ln g of the windows are joined where their slopes
+ * agree best, then normalized to 2^N states. Exchanges use the
+ * generator of the annealer and every walker has its own, so the result does not depend on the
+ * thread count.
+ */
+class Anlr_WL : public Annealer {
+  private:
+    class Grph_WL : public Graph {
+        friend class Anlr_WL;
+
+      public:
+        Grph_WL();
+        Grph_WL(const Graph&);
+    };
+    struct Walker {
+        std::vector<Spin> spins;
+        std::vector<int64_t> fields; // sum_j w_ij s_j + h_i of every spin
+        int64_t energy = 0;          // Without the constant
+        int64_t low = 0, high = 0;   // Energies of the window
+        std::vector<double> ln_g;
+        std::vector<long> histogram; // Since the last ln f update
+        std::vector<bool> visited;   // Ever
+        double ln_f    = 1.0;
+        long moves     = 0;         // Proposals in total, the time of the 1/t stage
+        bool inverse   = false;     // ln f follows 1/t
+        int64_t lowest = INT64_MAX; // Lowest energy proposed, below the window too
+        std::mt19937 generator;
+    };
+    Grph_WL graph;
+    Params_WL params;
+    std::vector<int> offsets, neighbors; // Couplings of spin i at [offsets[i], offsets[i + 1])
+    std::vector<int64_t> weights, fields;
+    int64_t step    = 0;           // Energy of a bin
+    double constant = 0.0;         // Constant and self loops
+    int64_t low     = 0;           // Energy of bin 0
+    std::vector<int> starts, ends; // First and last bin of every window
+    std::vector<Walker> walkers;
+    std::vector<DensityPoint> density;
+
+    void setFields(Walker&) const; // fields and energy from the spins
+    inline int64_t difference (const Walker& w, const int& i) const {
+        return -2 * (int64_t)w.spins[i] * w.fields[i];
+    }
+    void flip(Walker&, const int&) const;
+    Walker extreme(const int&);             // sign, lowest sign * E of an anneal
+    void approach(Walker&) const;           // Walk into the window
+    void sweeps(Walker&, const int&) const; // Wang-Landau sweeps
+    void exchange(const int&);              // Walkers k and k + 1
+    bool flat(const Walker&) const;
+    void refine(Walker&) const; // Next ln f after a block of sweeps
+    void join(); // density from the windows
+
+  public:
+    Anlr_WL();
+    Anlr_WL(const Graph&, const Params_WL&);
+    Params_WL getParams() const;
+
+    // Virtual functions
+    double anneal(); // Returns the lowest energy found
+
+    // Getter
+    std::vector<DensityPoint> getDensity() const; // Visited energies, increasing
+
+    // Reexported functions from Graph, the graph holds the lowest configuration after anneal
+    int getLength() const;
+    int getHeight() const;
+    std::vector<Spin> getSpins() const;
+    double getHamiltonianEnergy() const;
+};
+
+#endif
@@ -1,14 +1,117 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <functional>
 #include <random>
+#include <sstream>
 
+#include "../profile/Profile.h"
 #include "Annealer.h"
 
-Annealer::Annealer (const int r) : myrank(r) {}
+#ifdef USE_MPI
+#include "MpiAnnealer.h"
+#endif
+
+Annealer::Annealer (const int r) : generator(std::random_device {}()), myrank(r) {}
+
+void Annealer::setSeed (const unsigned int& seed) {
+    this->generator.seed(seed);
+    return;
+}
+
+void Annealer::setCheckpoint (const CheckpointPolicy& policy) {
+    this->checkpoint_policy = policy;
+    this->last_checkpoint   = std::chrono::steady_clock::now();
+    return;
+}
+
+void Annealer::setStop (const StopPolicy& policy) {
+    this->stop_policy = policy;
+    return;
+}
+
+void Annealer::setCancel (const std::shared_ptr<std::atomic<bool> >& flag) {
+    this->cancel_flag = flag;
+    return;
+}
+
+void Annealer::setOrderTracking (const int& width, const int& every) {
+    this->order = OrderTracker(width, every);
+    return;
+}
+
+void Annealer::startClock () {
+    this->anneal_start = std::chrono::steady_clock::now();
+    return;
+}
+
+double Annealer::getBestEnergy () const {
+    return this->best.getEnergy();
+}
+
+const std::vector<OrderSample>& Annealer::getOrderSamples () const {
+    return this->order.getSamples();
+}
+
+double Annealer::elapsed () const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->anneal_start)
+        .count();
+}
+
+// Whether the given step runs: tau bounds the run unless the clock drives the schedule
+bool Annealer::running (const int& step, const int& tau) const {
+    if (this->stopped) return false;
+    return this->stop_policy.time_limit > 0.0 || step <= tau;
+}
+
+// Schedule position of the step, the fraction of the time budget under a time limit. The step
+// reaching the end of the budget runs at the final value and is the last one.
+double Annealer::progress (const int& step, const int& tau) {
+    if (this->stop_policy.time_limit > 0.0) {
+        const double s = std::min(1.0, this->elapsed() / this->stop_policy.time_limit);
+        if (s >= 1.0) this->stop_requested = true;
+        return s;
+    }
+    return tau > 0 ? (double)step / tau : 1.0;
+}
+
+bool Annealer::observing () const {
+    return this->stop_policy.stagnation > 0 || this->stop_policy.has_target;
+}
+
+void Annealer::observe (const double& energy, const int& sweeps) {
+    const StopPolicy& p = this->stop_policy;
+    if (energy < this->stall_best) {
+        this->stall_best   = energy;
+        this->stall_sweeps = 0;
+    } else {
+        this->stall_sweeps += sweeps;
+    }
+    if (p.stagnation > 0 && this->stall_sweeps >= p.stagnation) this->stop_requested = true;
+    if (p.has_target && energy <= p.target_energy) {
+        this->stop_requested = true;
+        if (this->cancel_flag) this->cancel_flag->store(true); // Cancel the other replicas
+    }
+    return;
+}
+
+bool Annealer::stopping () const {
+    return this->stop_requested || (this->cancel_flag && this->cancel_flag->load());
+}
+
+// Replicas exchanging configurations under MPI must stop together, they agree at the exchange
+// steps. Partitioned annealers agree on every step themselves.
+bool Annealer::agreeStop (const int& step) {
+#ifdef USE_MPI
+    if (step % EXCHANGE_INTERVAL != 0) return false;
+    return anyRank(this->stopping());
+#else
+    return this->stopping();
+#endif
+}
 
 // Randomly execute the given function with probability rand
 bool Annealer::randomExec (const double rand, const std::function<void()> func) {
-    // Random number generator
-    std::mt19937 generator(std::random_device {}());
     std::uniform_real_distribution<double> dis(0.0, 1.0);
 
     if (dis(generator) < rand) {
@@ -18,3 +121,50 @@ bool Annealer::randomExec (const double rand, const std::function<void()> func)
 
     return false;
 }
+
+// min(1, exp(-delta_E / T)), the greedy limit at T = 0 (accept unless uphill)
+double Annealer::acceptance (const double& delta_E, const double& T) {
+    if (T <= 0.0) return delta_E <= 0.0 ? 1.0 : 0.0;
+    return std::min(1.0, std::exp(-delta_E / T));
+}
+
+// Check if a checkpoint should be written before running the given step
+bool Annealer::checkpointDue (const int& next_step) {
+    const CheckpointPolicy& p = this->checkpoint_policy;
+    if (p.path.empty()) return false;
+    if (p.every_sweeps > 0 && next_step % p.every_sweeps == 0) return true;
+    if (p.every_secs > 0.0) {
+        const std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - this->last_checkpoint;
+        if (elapsed.count() >= p.every_secs) return true;
+    }
+    return false;
+}
+
+void Annealer::saveCheckpoint (const int& func, const int& next_step, const double& param,
+                               const std::vector<Spin>& spins) {
+    PROFILE_SCOPE(profile::CHECKPOINT);
+    Checkpoint c;
+    c.func  = func;
+    c.rank  = this->myrank;
+    c.step  = next_step;
+    c.param = param;
+    std::ostringstream rng;
+    rng << this->generator;
+    c.rng         = rng.str();
+    c.spins       = spins;
+    c.best_energy = this->best.getEnergy();
+    c.best_spins  = this->best.getBest(spins);
+    writeCheckpoint(this->checkpoint_policy.path, c);
+
+    this->last_checkpoint = std::chrono::steady_clock::now();
+    return;
+}
+
+void Annealer::restoreCheckpoint (const Checkpoint& c) {
+    std::istringstream rng(c.rng);
+    rng >> this->generator;
+    this->start_step = c.step;
+    this->best.restore(c.best_energy, c.best_spins);
+    return;
+}
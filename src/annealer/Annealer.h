@@ -1,18 +1,73 @@
 #ifndef _ANNEALER_H_
 #define _ANNEALER_H_
 
+#include <atomic>
+#include <cfloat>
+#include <chrono>
 #include <functional>
+#include <memory>
+#include <random>
 
 #include "../graph/Graph.h"
+#include "BestTracker.h"
+#include "Checkpoint.h"
+#include "OrderTracker.h"
+
+struct StopPolicy {
+    double time_limit    = 0.0;   // Wall-clock budget in seconds, the schedule follows the clock
+    int stagnation       = 0;     // Stop once the best energy did not improve for N sweeps
+    bool has_target      = false; // Stop once the energy reaches target_energy
+    double target_energy = 0.0;
+};
 
 class Annealer {
   protected:
+    std::mt19937 generator; // Per annealer generator, part of the checkpointed state
+    CheckpointPolicy checkpoint_policy;
+    std::chrono::steady_clock::time_point last_checkpoint;
+    int start_step = 0; // First schedule step to run (non zero after resume)
+    BestTracker best;   // Lowest energy seen and its configuration
+    OrderTracker order; // Order parameter of the triangular lattice (--op-every)
+
     bool randomExec(const double, const std::function<void()>);
+    static double acceptance(const double&, const double&); // Metropolis, delta E and T >= 0
+
+    /* Checkpoint */
+    bool checkpointDue(const int&); // next step
+    void saveCheckpoint(const int&, const int&, const double&,
+                        const std::vector<Spin>&); // func, next step, param, spins
+    void restoreCheckpoint(const Checkpoint&); // rng, step and best-so-far
+
+    /* Termination */
+    StopPolicy stop_policy;
+    std::shared_ptr<std::atomic<bool> > cancel_flag; // Shared by replicas, set on reaching target
+    std::chrono::steady_clock::time_point anneal_start;
+    bool stop_requested = false; // This replica wants to stop
+    bool stopped        = false; // Every replica taking part agreed to stop
+    double stall_best   = DBL_MAX;
+    int stall_sweeps    = 0;
+
+    void startClock();
+    bool running(const int&, const int&) const; // step, tau
+    double progress(const int&, const int&);    // Schedule position of step, tau in [0, 1]
+    bool observing() const;                     // Whether observe needs the energy
+    void observe(const double&, const int&);    // energy after the given number of sweeps
+    bool stopping() const;                      // Local stop request or cancelled
+    bool agreeStop(const int&);                 // Decide to stop after the given step
 
   public:
     int myrank;
     Annealer(const int);
 
+    void setSeed(const unsigned int&);
+    void setCheckpoint(const CheckpointPolicy&);
+    void setStop(const StopPolicy&);
+    void setCancel(const std::shared_ptr<std::atomic<bool> >&);
+    void setOrderTracking(const int&, const int&); // lattice width, sample every k sweeps
+    double elapsed() const;       // Seconds since the anneal started
+    double getBestEnergy() const; // Lowest energy seen by anneal
+    const std::vector<OrderSample>& getOrderSamples() const;
+
     virtual double anneal() = 0;
 };
 
@@ -0,0 +1,30 @@
+#include "BestTracker.h"
+
+void BestTracker::freeze (const std::vector<Spin>& current) {
+    if (this->is_saved) return;
+    this->saved    = this->getBest(current);
+    this->is_saved = true;
+    this->journal.clear();
+    return;
+}
+
+void BestTracker::restore (const double& energy, const std::vector<Spin>& spins) {
+    this->best_energy = energy;
+    this->saved       = spins;
+    this->is_saved    = !spins.empty();
+    this->journal.clear();
+    return;
+}
+
+double BestTracker::getEnergy () const {
+    return this->best_energy;
+}
+
+std::vector<Spin> BestTracker::getBest (const std::vector<Spin>& current) const {
+    if (this->is_saved) return this->saved;
+    std::vector<Spin> best(current);
+    // Flips commute, undo them in any order
+    for (const int& index : this->journal)
+        best[index] = (best[index] == UP) ? DOWN : UP;
+    return best;
+}
@@ -0,0 +1,50 @@
+#ifndef _BESTTRACKER_H_
+#define _BESTTRACKER_H_
+
+#include <cfloat>
+#include <vector>
+
+#include "../include/Spin.h"
+
+/*
+ * Best-so-far configuration without copying the spins on every improvement. While the best is
+ * recent it is the current configuration with the journaled flips undone; once the journal
+ * outgrows the configuration the best is copied out once and journaling pauses until the next
+ * improvement. Every flip costs O(1) amortized.
+ */
+class BestTracker {
+  private:
+    double best_energy = DBL_MAX;
+    std::vector<int> journal; // Flips applied since the best configuration (when not saved)
+    std::vector<Spin> saved;  // Copy of the best configuration (when saved)
+    bool is_saved = false;
+
+  public:
+    // After flipping index of current to the given energy, true if it is a new best
+    inline bool flip (const int& index, const double& energy, const std::vector<Spin>& current) {
+        if (this->update(energy)) return true;
+        this->record(index, current);
+        return false;
+    }
+    // Journal a flip already applied to current
+    inline void record (const int& index, const std::vector<Spin>& current) {
+        if (this->is_saved) return;
+        this->journal.push_back(index);
+        if (this->journal.size() > current.size()) this->freeze(current);
+    }
+    // The current configuration has the given energy, true if it is a new best
+    inline bool update (const double& energy) {
+        if (energy >= this->best_energy) return false;
+        this->best_energy = energy;
+        this->journal.clear();
+        this->is_saved = false;
+        return true;
+    }
+
+    void freeze(const std::vector<Spin>&); // Save the best before a change that is not journaled
+    void restore(const double&, const std::vector<Spin>&); // Best energy and configuration
+    double getEnergy() const;                               // DBL_MAX before the first update
+    std::vector<Spin> getBest(const std::vector<Spin>&) const; // Given the current configuration
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "Checkpoint.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+static const char MAGIC[4]    = { 'D', 'A', 'C', 'K' };
+static const uint32_t VERSION = 1;
+
+template <typename T>
+static void put (std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+static T get (std::ifstream& in) {
+    T value;
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(T)))
+        throw std::runtime_error("Truncated checkpoint");
+    return value;
+}
+
+static void putSpins (std::ofstream& out, const std::vector<Spin>& spins) {
+    put<uint32_t>(out, spins.size());
+    std::vector<unsigned char> bits((spins.size() + 7) / 8, 0);
+    for (size_t i = 0; i < spins.size(); ++i)
+        if (spins[i] == UP) bits[i / 8] |= (1 << (i % 8));
+    out.write(reinterpret_cast<const char *>(bits.data()), bits.size());
+}
+
+static std::vector<Spin> getSpins (std::ifstream& in) {
+    const uint32_t count = get<uint32_t>(in);
+    std::vector<unsigned char> bits((count + 7) / 8, 0);
+    if (!in.read(reinterpret_cast<char *>(bits.data()), bits.size()))
+        throw std::runtime_error("Truncated checkpoint");
+    std::vector<Spin> spins(count, DOWN);
+    for (uint32_t i = 0; i < count; ++i)
+        if (bits[i / 8] & (1 << (i % 8))) spins[i] = UP;
+    return spins;
+}
+
+void writeCheckpoint (const std::string& path, const Checkpoint& c) {
+    const std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) throw std::runtime_error("Cannot open checkpoint " + tmp);
+
+    out.write(MAGIC, 4);
+    put<uint32_t>(out, VERSION);
+    put<int32_t>(out, c.func);
+    put<int32_t>(out, c.rank);
+    put<int32_t>(out, c.step);
+    put<double>(out, c.param);
+    put<uint32_t>(out, c.rng.size());
+    out.write(c.rng.data(), c.rng.size());
+    putSpins(out, c.spins);
+    put<double>(out, c.best_energy);
+    putSpins(out, c.best_spins);
+    out.close();
+
+    // Replace the previous checkpoint only once the new one is complete
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Cannot write checkpoint " + path);
+    return;
+}
+
+Checkpoint readCheckpoint (const std::string& path) {
+    std::ifstream in(path, std::ios::in | std::ios::binary);
+    if (!in.is_open()) throw std::runtime_error("Cannot open checkpoint " + path);
+
+    char magic[4];
+    if (!in.read(magic, 4) || std::string(magic, 4) != std::string(MAGIC, 4))
+        throw std::runtime_error("Not a checkpoint file " + path);
+    if (get<uint32_t>(in) != VERSION) throw std::runtime_error("Unsupported checkpoint version");
+
+    Checkpoint c;
+    c.func               = get<int32_t>(in);
+    c.rank               = get<int32_t>(in);
+    c.step               = get<int32_t>(in);
+    c.param              = get<double>(in);
+    const uint32_t rng_n = get<uint32_t>(in);
+    c.rng.resize(rng_n);
+    if (!in.read(c.rng.data(), rng_n)) throw std::runtime_error("Truncated checkpoint");
+    c.spins       = getSpins(in);
+    c.best_energy = get<double>(in);
+    c.best_spins  = getSpins(in);
+    return c;
+}
@@ -0,0 +1,34 @@
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include <string>
+#include <vector>
+
+#include "../include/Spin.h"
+
+/*
+ * Binary snapshot of an annealing run (little endian, spins packed 8 per byte):
+ *   "DACK" | version u32 | func i32 | rank i32 | step i32 | param f64 | rng (u32 len + bytes)
+ *   | spins (u32 count + bits) | best energy f64 | best spins (u32 count + bits)
+ */
+struct Checkpoint {
+    int func           = 0;   // ANNEAL_FUNC of the run
+    int rank           = 0;   // Replica the snapshot belongs to
+    int step           = 0;   // Next schedule step to run
+    double param       = 0.0; // Temperature / gamma of the last finished step
+    std::string rng;          // Serialized generator state
+    std::vector<Spin> spins;  // Current configuration
+    double best_energy = 0.0; // Lowest energy seen so far
+    std::vector<Spin> best_spins;
+};
+
+struct CheckpointPolicy {
+    std::string path;        // File to write, empty to disable
+    int every_sweeps  = 0;   // Write every N sweeps (0 to disable)
+    double every_secs = 0.0; // Write every T seconds (0 to disable)
+};
+
+void writeCheckpoint(const std::string&, const Checkpoint&); // Atomic (write then rename)
+Checkpoint readCheckpoint(const std::string&);               // Throws on malformed files
+
+#endif
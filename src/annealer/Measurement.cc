@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+
+#include "Measurement.h"
+
+void Estimator::add (const double& x) {
+    this->bin(0, x);
+    this->block_sum += x;
+    if (++this->block_fill < this->block_size) return;
+    this->blocks.push_back(this->block_sum / this->block_size);
+    this->block_sum  = 0.0;
+    this->block_fill = 0;
+    if (this->blocks.size() < 2 * MIN_BINS) return;
+    // Merge the blocks pairwise, the next ones are twice as long
+    for (int i = 0; i < MIN_BINS; ++i)
+        this->blocks[i] = (this->blocks[2 * i] + this->blocks[2 * i + 1]) / 2;
+    this->blocks.resize(MIN_BINS);
+    this->block_size *= 2;
+    return;
+}
+
+void Estimator::bin (const int& level, const double& x) {
+    if (level == (int)this->levels.size()) this->levels.emplace_back();
+    Level& l       = this->levels[level];
+    const double d = x - l.mean;
+    l.mean += d / ++l.count;
+    l.m2 += d * (x - l.mean);
+    if (!l.waiting) {
+        l.pending = x;
+        l.waiting = true;
+        return;
+    }
+    l.waiting = false;
+    this->bin(level + 1, (l.pending + x) / 2); // May move the levels, l is not used after
+    return;
+}
+
+// The largest bins of which there are at least MIN_BINS (the samples themselves if fewer)
+int Estimator::errorLevel () const {
+    int level = 0;
+    while (level + 1 < (int)this->levels.size() && this->levels[level + 1].count >= MIN_BINS)
+        ++level;
+    return level;
+}
+
+long Estimator::count () const {
+    return this->levels.empty() ? 0 : this->levels[0].count;
+}
+
+double Estimator::mean () const {
+    return this->levels.empty() ? 0.0 : this->levels[0].mean;
+}
+
+double Estimator::error () const {
+    if (this->count() < 2) return 0.0;
+    const Level& l = this->levels[this->errorLevel()];
+    return std::sqrt(l.m2 / (l.count - 1) / l.count);
+}
+
+double Estimator::tau () const {
+    if (this->count() < 2) return 0.5;
+    const Level& l      = this->levels[0];
+    const double naive  = l.m2 / (l.count - 1) / l.count;
+    const double binned = this->error() * this->error();
+    // Anticorrelated or noisy bins can read below the uncorrelated 0.5, which is a lower bound
+    return naive > 0.0 ? std::max(0.5, 0.5 * binned / naive) : 0.5;
+}
+
+const std::vector<double>& Estimator::getBlocks () const {
+    return this->blocks;
+}
+
+namespace {
+
+// f of the means, bias corrected with its jackknife error over the blocks (the estimators saw
+// the same samples). The value and the leave-one-out estimates both use the complete blocks
+// only, the samples of the trailing partial block are left out of either.
+Estimate jackknife (const std::string& name, const std::vector<const Estimator *>& in,
+                    const std::function<double(const std::vector<double>&)>& f) {
+    std::vector<double> means(in.size()), totals(in.size(), 0.0);
+    const size_t n = in[0]->getBlocks().size();
+    if (n < 2) {
+        for (size_t i = 0; i < in.size(); ++i)
+            means[i] = in[i]->mean();
+        return Estimate { name, f(means), 0.0, -1.0 };
+    }
+
+    for (size_t i = 0; i < in.size(); ++i) {
+        for (const double& b : in[i]->getBlocks())
+            totals[i] += b;
+        means[i] = totals[i] / n;
+    }
+    const double full = f(means);
+    std::vector<double> leave_out(n);
+    double average = 0.0;
+    for (size_t j = 0; j < n; ++j) {
+        for (size_t i = 0; i < in.size(); ++i)
+            means[i] = (totals[i] - in[i]->getBlocks()[j]) / (n - 1);
+        leave_out[j] = f(means);
+        average += leave_out[j] / n;
+    }
+    double spread = 0.0;
+    for (const double& v : leave_out)
+        spread += (v - average) * (v - average);
+    return Estimate { name, n * full - (n - 1) * average, std::sqrt(spread * (n - 1) / n), -1.0 };
+}
+
+Estimate direct (const std::string& name, const Estimator& x) {
+    return Estimate { name, x.mean(), x.error(), x.tau() };
+}
+
+} // namespace
+
+Measurement::Measurement (const int& spins, const double& beta) : spins(spins), beta(beta) {}
+
+void Measurement::add (const double& energy, const std::vector<Spin>& config,
+                       const OrderTracker& order) {
+    const double energy_per_spin = energy / this->spins;
+    this->e.add(energy_per_spin);
+    this->e2.add(energy_per_spin * energy_per_spin);
+
+    long sum = 0;
+    for (const Spin& s : config)
+        sum += s;
+    const double magnetization = (double)sum / config.size();
+    this->m.add(magnetization);
+    this->abs_m.add(std::abs(magnetization));
+    this->m2.add(magnetization * magnetization);
+    this->m4.add(magnetization * magnetization * magnetization * magnetization);
+
+    if (!order.enabled()) return;
+    const int layers = order.getLayers();
+    double abs_op = 0.0, squared = 0.0, fourth = 0.0;
+    for (int l = 0; l < layers; ++l) {
+        const double q = order.squared(l);
+        abs_op += std::sqrt(q) / layers;
+        squared += q / layers;
+        fourth += q * q / layers;
+    }
+    this->psi.add(abs_op);
+    this->psi2.add(squared);
+    this->psi4.add(fourth);
+    return;
+}
+
+double Measurement::meanEnergy () const {
+    return this->e.mean() * this->spins;
+}
+
+// Fluctuations are per spin of a layer: C = N beta^2 var(e), chi = N beta (<m^2> - <|m|>^2)
+std::vector<Estimate> Measurement::summary () const {
+    const double n = this->spins, beta = this->beta;
+    // scale (<x^2> - <x>^2) of the means <x>, <x^2>
+    auto variance = [] (const double& scale) {
+        return [=] (const std::vector<double>& v) { return scale * (v[1] - v[0] * v[0]); };
+    };
+    // 1 - <x^4> / (c <x^2>^2), c = 3 for a scalar and 2 for the two components of psi, so the
+    // cumulant goes to 0 in the disordered phase
+    auto binder = [] (const double& c) {
+        return [=] (const std::vector<double>& v) { return 1 - v[1] / (c * v[0] * v[0]); };
+    };
+    std::vector<Estimate> results = {
+        direct("energy", this->e),
+        jackknife("specific_heat", { &this->e, &this->e2 }, variance(n * beta * beta)),
+        direct("magnetization", this->m),
+        direct("abs_magnetization", this->abs_m),
+        direct("squared_magnetization", this->m2),
+        jackknife("susceptibility", { &this->abs_m, &this->m2 }, variance(n * beta)),
+        jackknife("binder", { &this->m2, &this->m4 }, binder(3)),
+    };
+    if (this->psi.count() == 0) return results;
+    results.push_back(direct("abs_op", this->psi));
+    results.push_back(direct("squared_op", this->psi2));
+    results.push_back(
+        jackknife("susceptibility_op", { &this->psi, &this->psi2 }, variance(n * beta)));
+    results.push_back(jackknife("binder_op", { &this->psi2, &this->psi4 }, binder(2)));
+    return results;
+}
+
+void Measurement::write (std::ostream& out) const {
+    out << "observable\tvalue\terror\ttau\n" << std::setprecision(10);
+    for (const Estimate& r : this->summary()) {
+        out << r.name << "\t" << r.value << "\t" << r.error << "\t";
+        if (r.tau < 0) out << "-\n";
+        else out << r.tau << "\n";
+    }
+    out << "samples\t" << this->e.count() << "\t-\t-\n";
+    return;
+}
@@ -0,0 +1,74 @@
+#ifndef _MEASUREMENT_H_
+#define _MEASUREMENT_H_
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../include/Spin.h"
+#include "OrderTracker.h"
+
+const int MIN_BINS = 32; // Bins the error of a mean is read from, and jackknife blocks (at least)
+
+/*
+ * Streaming mean, variance and error of a series of correlated samples in O(log n) memory.
+ * Level k of the binning analysis averages bins of 2^k samples (Welford on the bin means); the
+ * error of the mean is read from the largest bins of which there are at least MIN_BINS, and
+ * the integrated autocorrelation time is half the ratio of that variance of the mean to the
+ * naive one, at least 0.5 (uncorrelated samples). The last MIN_BINS to 2 * MIN_BINS block means
+ * are kept for the jackknife.
+ */
+class Estimator {
+  private:
+    struct Level {
+        long count     = 0;
+        double mean    = 0.0, m2 = 0.0; // Welford over the bins
+        double pending = 0.0;           // First half of the next bin
+        bool waiting   = false;
+    };
+    std::vector<Level> levels;
+    std::vector<double> blocks; // Means of the complete blocks
+    long block_size = 1, block_fill = 0;
+    double block_sum = 0.0;
+
+    void bin(const int&, const double&); // level, bin mean
+    int errorLevel() const;
+
+  public:
+    void add(const double&);
+    long count() const;
+    double mean() const;
+    double error() const; // Of the mean
+    double tau() const;   // Integrated autocorrelation time, in samples
+    const std::vector<double>& getBlocks() const;
+};
+
+struct Estimate {
+    std::string name;
+    double value, error;
+    double tau; // < 0 for the derived quantities
+};
+
+/*
+ * Observables of an equilibrium run, a sample after every sweep: energy and magnetization per
+ * spin and, on the --h-tri lattice, the order parameter |psi| (mean over the Trotter layers).
+ * Specific heat, susceptibilities and Binder cumulants are fluctuations of these, bias corrected
+ * with jackknife errors over the complete blocks of the estimators.
+ */
+class Measurement {
+  private:
+    int spins;   // Per layer
+    double beta; // Inverse temperature of the sweeps
+    Estimator e, e2, m, abs_m, m2, m4, psi, psi2, psi4;
+
+  public:
+    Measurement(const int&, const double&); // spins per layer, beta
+
+    void add(const double&, const std::vector<Spin>&,
+             const OrderTracker&); // energy per layer, spins, order
+    double meanEnergy() const; // Of a layer
+    std::vector<Estimate> summary() const;
+    void write(std::ostream&) const; // observable, value, error, tau lines
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "MpiAnnealer.h"
 #include "../graph/Graph.h"
+#include "../profile/Profile.h"
 
 #include <cmath>
 #include <functional>
@@ -27,12 +28,19 @@ bool configCompare (double& src1, double& src2, double& target1, double& target2
 
 bool swap (const int myrank, double cmp_src1, double cmp_src2, std::vector<Spin>& config,
            deltaSGenFunc deltaS_func) {
+    PROFILE_SCOPE(profile::EXCHANGE);
     MPI_Request requests = MPI_REQUEST_NULL;
     MPI_Status status;
 
     int src_a = myrank % 2 == 0 ? myrank : myrank - 1;
     int src_b = myrank % 2 == 0 ? myrank + 1 : myrank;
 
+    // The last rank of an odd count has no partner
+    int nprocs = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    if (src_b >= nprocs) return false;
+    PROFILE_COUNT(profile::EXCHANGES, 1);
+
     int tag_a = src_a;
     int tag_b = src_b;
 
@@ -51,16 +59,15 @@ bool swap (const int myrank, double cmp_src1, double cmp_src2, std::vector<Spin>
 
         MPI_Send(&cmp_src2, 1, MPI_DOUBLE, src_b, tag_a, MPI_COMM_WORLD);
         MPI_Wait(&requests, &status);
+        PROFILE_COUNT(profile::BYTES_SENT, 2 * sizeof(double));
 
         // Receive to know if two config is swapped
         MPI_Recv(&is_swap, 1, MPI_CXX_BOOL, src_b, tag_b, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
 
+        // Both ranks send at once, a blocking send of a large config would wait for the receive
         if (is_swap) {
-            MPI_Send(&config[0], config_size, MPI_INT, src_b, tag_a, MPI_COMM_WORLD);
-            MPI_Wait(&requests, &status);
-
-            MPI_Recv(&buffer[0], config_size, MPI_INT, src_b, tag_b, MPI_COMM_WORLD,
-                     MPI_STATUS_IGNORE);
+            MPI_Sendrecv(&config[0], config_size, MPI_INT, src_b, tag_a, &buffer[0], config_size,
+                         MPI_INT, src_b, tag_b, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         } else {
             // no swap
         }
@@ -77,20 +84,72 @@ bool swap (const int myrank, double cmp_src1, double cmp_src2, std::vector<Spin>
 
         MPI_Send(&is_swap, 1, MPI_CXX_BOOL, src_a, tag_b, MPI_COMM_WORLD);
         MPI_Wait(&requests, &status);
+        PROFILE_COUNT(profile::BYTES_SENT, sizeof(bool));
 
         // If the config need to be swapped, send the config to src_a
         if (is_swap) {
-            MPI_Send(&config[0], config_size, MPI_INT, src_a, tag_b, MPI_COMM_WORLD);
-            MPI_Wait(&requests, &status);
-
-            MPI_Recv(&buffer[0], config_size, MPI_INT, src_a, tag_a, MPI_COMM_WORLD,
-                     MPI_STATUS_IGNORE);
+            MPI_Sendrecv(&config[0], config_size, MPI_INT, src_a, tag_b, &buffer[0], config_size,
+                         MPI_INT, src_a, tag_a, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         } else {
             // no swap
         }
     }
 
-    if (is_swap) { config = buffer; }
+    if (is_swap) {
+        config = buffer;
+        PROFILE_COUNT(profile::EXCHANGE_ACCEPTS, 1);
+        PROFILE_COUNT(profile::BYTES_SENT, config_size * sizeof(Spin));
+    }
 
     return is_swap;
 }
+
+std::vector<int> houdayer (const int myrank, const std::vector<Spin>& config,
+                           const std::function<std::vector<int>(const std::vector<Spin>&)>& build) {
+    PROFILE_SCOPE(profile::EXCHANGE);
+    const int src_a = myrank % 2 == 0 ? myrank : myrank - 1;
+    const int src_b = myrank % 2 == 0 ? myrank + 1 : myrank;
+
+    int nprocs = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    if (src_b >= nprocs) return {};
+
+    int config_size = config.size(), cluster_size = 0;
+    std::vector<int> cluster;
+    if (myrank == src_a) {
+        std::vector<Spin> other(config_size);
+        MPI_Recv(&other[0], config_size, MPI_INT, src_b, src_b, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        cluster      = build(other);
+        cluster_size = cluster.size();
+        MPI_Send(&cluster_size, 1, MPI_INT, src_b, src_a, MPI_COMM_WORLD);
+        if (cluster_size > 0)
+            MPI_Send(&cluster[0], cluster_size, MPI_INT, src_b, src_a, MPI_COMM_WORLD);
+        PROFILE_COUNT(profile::BYTES_SENT, (1 + cluster_size) * sizeof(int));
+    } else {
+        MPI_Send(&config[0], config_size, MPI_INT, src_a, src_b, MPI_COMM_WORLD);
+        PROFILE_COUNT(profile::BYTES_SENT, config_size * sizeof(Spin));
+        MPI_Recv(&cluster_size, 1, MPI_INT, src_a, src_a, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        cluster.resize(cluster_size);
+        if (cluster_size > 0)
+            MPI_Recv(&cluster[0], cluster_size, MPI_INT, src_a, src_a, MPI_COMM_WORLD,
+                     MPI_STATUS_IGNORE);
+    }
+    return cluster;
+}
+
+bool anyRank (const bool& value) {
+    bool result = false;
+    MPI_Allreduce(&value, &result, 1, MPI_CXX_BOOL, MPI_LOR, MPI_COMM_WORLD);
+    return result;
+}
+
+// Gather the profile of every rank, in rank order (empty on ranks other than 0)
+std::vector<profile::Report> gatherProfile (const profile::Report& mine) {
+    int myrank = 0, nprocs = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    std::vector<profile::Report> reports(myrank == 0 ? nprocs : 0);
+    MPI_Gather(&mine, sizeof(profile::Report), MPI_BYTE, reports.data(), sizeof(profile::Report),
+               MPI_BYTE, 0, MPI_COMM_WORLD);
+    return reports;
+}
@@ -2,8 +2,11 @@
 #define _MPIANNEALER_H_
 
 #include "../graph/Graph.h"
+#include "../profile/Profile.h"
 #include <functional>
 
+const int EXCHANGE_INTERVAL = 8; // Steps between replica exchanges
+
 typedef std::function<double(double&, double&, double&, double&)> deltaSGenFunc;
 bool swap(const int, double, double, std::vector<Spin>&,
           deltaSGenFunc); // myrank, compare_src1, compare_src2, spin config
@@ -12,5 +15,11 @@ bool configCompare(double& src1, double& src2, double& target1, double& target2,
                    deltaSGenFunc deltaS_func);
 bool swap(const int myrank, double cmp_src1, double cmp_src2, std::vector<Spin>& config,
           deltaSGenFunc deltaS_func);
+// Houdayer move with the partner of swap(): the first rank of the pair builds the cluster from
+// both configurations and both get its indices (empty without a partner or a cluster)
+std::vector<int> houdayer(const int, const std::vector<Spin>&,
+                          const std::function<std::vector<int>(const std::vector<Spin>&)>&);
+bool anyRank(const bool&); // Collective, true if the value is true on any rank
+std::vector<profile::Report> gatherProfile(const profile::Report&); // Collective, rank 0 gets all
 
 #endif
@@ -0,0 +1,225 @@
+#include "MpiPartition.h"
+#include "../profile/Profile.h"
+
+#include <algorithm>
+#include <mpi.h>
+#include <stdexcept>
+
+// MpiPartition Constructor
+MpiPartition::MpiPartition () : myrank(0), nprocs(1), offsets({ 0, 0 }), color_count(1) {}
+MpiPartition::MpiPartition (const std::vector<int>& o) : offsets(o), color_count(1) {
+    MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    if ((int)offsets.size() != nprocs + 1) throw std::invalid_argument("Invalid partition offsets");
+    for (int i = this->getBegin(); i < this->getEnd(); ++i)
+        local_to_global.push_back(i);
+    return;
+}
+
+// Split [0, total) into nprocs contiguous blocks
+std::vector<int> MpiPartition::blockOffsets (const int& total) {
+    int nprocs = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    std::vector<int> o(nprocs + 1, 0);
+    for (int r = 0; r <= nprocs; ++r)
+        o[r] = (int)((long long)total * r / nprocs);
+    return o;
+}
+
+// Split rows of the given width into nprocs slabs, every slab holds at least one row
+std::vector<int> MpiPartition::sliceOffsets (const int& rows, const int& width) {
+    int nprocs = 1;
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    if (rows < nprocs) throw std::invalid_argument("Not enough rows to partition across ranks");
+    std::vector<int> o(nprocs + 1, 0);
+    for (int r = 0; r <= nprocs; ++r)
+        o[r] = (rows * r / nprocs) * width;
+    return o;
+}
+
+/* Index mapping */
+
+int MpiPartition::getBegin () const {
+    return this->offsets[myrank];
+}
+int MpiPartition::getEnd () const {
+    return this->offsets[myrank + 1];
+}
+int MpiPartition::getTotal () const {
+    return this->offsets.back();
+}
+int MpiPartition::getOwnedCount () const {
+    return this->getEnd() - this->getBegin();
+}
+int MpiPartition::getLocalCount () const {
+    return this->local_to_global.size();
+}
+
+int MpiPartition::getOwner (const int& global) const {
+    // offsets is sorted, the owner is the last rank starting at or before global
+    return std::upper_bound(offsets.begin(), offsets.end() - 1, global) - offsets.begin() - 1;
+}
+
+bool MpiPartition::isOwned (const int& global) const {
+    return global >= this->getBegin() && global < this->getEnd();
+}
+
+int MpiPartition::toLocal (const int& global) {
+    if (this->isOwned(global)) return global - this->getBegin();
+    std::unordered_map<int, int>::iterator it = halo_index.find(global);
+    if (it != halo_index.end()) return it->second;
+    const int local = local_to_global.size();
+    halo_index.insert({ global, local });
+    local_to_global.push_back(global);
+    return local;
+}
+
+int MpiPartition::toGlobal (const int& local) const {
+    return this->local_to_global[local];
+}
+
+/* Communication */
+
+void MpiPartition::lock () {
+    // Group the halo by owner, sorted by global index so both sides agree on the order
+    std::vector<std::vector<int> > requests(nprocs);
+    for (auto const& it : halo_index)
+        requests[this->getOwner(it.first)].push_back(it.first);
+
+    neighbors.clear();
+    send_local.clear();
+    recv_local.clear();
+    for (int r = 0; r < nprocs; ++r) {
+        if (requests[r].empty()) continue;
+        std::sort(requests[r].begin(), requests[r].end());
+        neighbors.push_back(r);
+        std::vector<int> recv;
+        for (const int& g : requests[r])
+            recv.push_back(halo_index[g]);
+        recv_local.push_back(recv);
+    }
+
+    // Every edge is stored on both sides, so a rank owning one of my halo spins needs exactly
+    // the spins of mine adjacent to its own: the requests mirror each other.
+    const int neighbor_count = neighbors.size();
+    std::vector<int> req_counts(neighbor_count), send_counts(neighbor_count);
+    std::vector<MPI_Request> reqs(2 * neighbor_count, MPI_REQUEST_NULL);
+    for (int n = 0; n < neighbor_count; ++n) {
+        req_counts[n] = requests[neighbors[n]].size();
+        MPI_Irecv(&send_counts[n], 1, MPI_INT, neighbors[n], 0, MPI_COMM_WORLD, &reqs[2 * n]);
+        MPI_Isend(&req_counts[n], 1, MPI_INT, neighbors[n], 0, MPI_COMM_WORLD, &reqs[2 * n + 1]);
+    }
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+    std::vector<std::vector<int> > wanted(neighbor_count);
+    for (int n = 0; n < neighbor_count; ++n) {
+        const int r = neighbors[n];
+        wanted[n].resize(send_counts[n]);
+        MPI_Irecv(wanted[n].data(), send_counts[n], MPI_INT, r, 1, MPI_COMM_WORLD, &reqs[2 * n]);
+        MPI_Isend(requests[r].data(), req_counts[n], MPI_INT, r, 1, MPI_COMM_WORLD,
+                  &reqs[2 * n + 1]);
+    }
+    MPI_Waitall(reqs.size(), reqs.data(), MPI_STATUSES_IGNORE);
+
+    for (int n = 0; n < neighbor_count; ++n) {
+        std::vector<int> send;
+        for (const int& g : wanted[n])
+            send.push_back(g - this->getBegin());
+        send_local.push_back(send);
+    }
+
+    // Greedy coloring of the rank graph, identical on every rank
+    std::vector<int> counts(nprocs), displs(nprocs, 0);
+    MPI_Allgather(&neighbor_count, 1, MPI_INT, counts.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int r = 1; r < nprocs; ++r)
+        displs[r] = displs[r - 1] + counts[r - 1];
+    std::vector<int> all_neighbors(displs.back() + counts.back());
+    MPI_Allgatherv(neighbors.data(), neighbor_count, MPI_INT, all_neighbors.data(), counts.data(),
+                   displs.data(), MPI_INT, MPI_COMM_WORLD);
+
+    rank_colors.assign(nprocs, -1);
+    color_count = 1;
+    for (int r = 0; r < nprocs; ++r) {
+        std::vector<bool> used(nprocs + 1, false);
+        for (int k = displs[r]; k < displs[r] + counts[r]; ++k) {
+            const int c = rank_colors[all_neighbors[k]];
+            if (c >= 0) used[c] = true;
+        }
+        int c = 0;
+        while (used[c])
+            ++c;
+        rank_colors[r] = c;
+        color_count    = std::max(color_count, c + 1);
+    }
+    return;
+}
+
+int MpiPartition::getColor () const {
+    return this->rank_colors.empty() ? 0 : this->rank_colors[myrank];
+}
+int MpiPartition::getColorCount () const {
+    return this->color_count;
+}
+
+// Ranks of the given color send their boundary spins, their neighbors receive them
+void MpiPartition::exchange (std::vector<Spin>& spins, const int& color) {
+    this->post(spins, color);
+    this->wait(spins);
+    return;
+}
+
+// The boundary spins are copied out here, only the halo spins must wait for the exchange
+void MpiPartition::post (const std::vector<Spin>& spins, const int& color) {
+    PROFILE_SCOPE(profile::EXCHANGE);
+    PROFILE_COUNT(profile::EXCHANGES, 1);
+    if (this->pending_color >= 0) throw std::logic_error("A halo exchange is already posted");
+    this->pending_color = color;
+    this->requests.clear();
+    this->send_buf.assign(neighbors.size(), std::vector<int>());
+    this->recv_buf.assign(neighbors.size(), std::vector<int>());
+
+    for (int n = 0; n < (int)neighbors.size(); ++n) {
+        if (rank_colors[neighbors[n]] != color) continue;
+        recv_buf[n].resize(recv_local[n].size());
+        requests.push_back(MPI_REQUEST_NULL);
+        MPI_Irecv(recv_buf[n].data(), recv_buf[n].size(), MPI_INT, neighbors[n], color,
+                  MPI_COMM_WORLD, &requests.back());
+    }
+    if (this->getColor() == color) {
+        for (int n = 0; n < (int)neighbors.size(); ++n) {
+            for (const int& l : send_local[n])
+                send_buf[n].push_back(spins[l]);
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(send_buf[n].data(), send_buf[n].size(), MPI_INT, neighbors[n], color,
+                      MPI_COMM_WORLD, &requests.back());
+            PROFILE_COUNT(profile::BYTES_SENT, send_buf[n].size() * sizeof(int));
+        }
+    }
+    return;
+}
+
+void MpiPartition::wait (std::vector<Spin>& spins) {
+    PROFILE_SCOPE(profile::EXCHANGE);
+    if (this->pending_color < 0) throw std::logic_error("No halo exchange is posted");
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+    for (int n = 0; n < (int)neighbors.size(); ++n) {
+        if (rank_colors[neighbors[n]] != this->pending_color) continue;
+        for (int k = 0; k < (int)recv_local[n].size(); ++k)
+            spins[recv_local[n][k]] = (Spin)recv_buf[n][k];
+    }
+    this->pending_color = -1;
+    return;
+}
+
+double MpiPartition::reduce (const double& value) const {
+    double sum = 0.0;
+    MPI_Allreduce(&value, &sum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return sum;
+}
+
+bool MpiPartition::any (const bool& value) const {
+    bool result = false;
+    MPI_Allreduce(&value, &result, 1, MPI_CXX_BOOL, MPI_LOR, MPI_COMM_WORLD);
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef _MPIPARTITION_H_
+#define _MPIPARTITION_H_
+
+#include "../graph/Graph.h"
+
+#include <mpi.h>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Domain decomposition of a single graph across MPI ranks.
+ *
+ * Every rank owns the contiguous global range [begin, end) and keeps a local copy of the spins
+ * adjacent to it (halo). Local indices are [0, owned) for owned spins followed by the halo spins.
+ * Ranks are colored so that no two neighboring ranks share a color, boundary spins are only
+ * updated by the ranks of the current color, then halos are refreshed before the next color.
+ */
+class MpiPartition {
+  private:
+    int myrank, nprocs;
+    std::vector<int> offsets;                // offsets[r] = first global index owned by rank r
+    std::vector<int> local_to_global;        // local index -> global index
+    std::unordered_map<int, int> halo_index; // global index -> local index (halo only)
+
+    /* Exchange plan (built by lock) */
+    std::vector<int> neighbors;                // neighboring ranks
+    std::vector<std::vector<int> > send_local; // per neighbor, owned local indices to send
+    std::vector<std::vector<int> > recv_local; // per neighbor, halo local indices to receive
+    std::vector<int> rank_colors;              // color of every rank
+    int color_count;
+
+    /* Exchange in flight (between post and wait) */
+    int pending_color = -1;
+    std::vector<MPI_Request> requests;
+    std::vector<std::vector<int> > send_buf, recv_buf; // per neighbor
+
+  public:
+    MpiPartition();
+    MpiPartition(const std::vector<int>&); // offsets (size nprocs + 1)
+
+    static std::vector<int> blockOffsets(const int&);             // total spins
+    static std::vector<int> sliceOffsets(const int&, const int&); // rows, row width
+
+    /* Index mapping */
+    int getBegin() const;
+    int getEnd() const;
+    int getTotal() const;
+    int getOwnedCount() const;
+    int getLocalCount() const;
+    int getOwner(const int&) const;    // global index -> owner rank
+    bool isOwned(const int&) const;    // global index
+    int toLocal(const int&);           // global index -> local index (allocates halo)
+    int toGlobal(const int&) const;    // local index -> global index
+
+    /* Communication */
+    void lock();                                   // Build the exchange plan and rank coloring
+    int getColor() const;                          // Color of this rank
+    int getColorCount() const;                     // Number of colors (phases per sweep)
+    void exchange(std::vector<Spin>&, const int&); // Refresh halos written in the given color
+    void post(const std::vector<Spin>&, const int&); // Start exchange, spins may change meanwhile
+    void wait(std::vector<Spin>&);                  // Finish it, the halos are refreshed
+    double reduce(const double&) const;            // Sum over all ranks
+    bool any(const bool&) const;                   // True if true on any rank
+};
+
+#endif
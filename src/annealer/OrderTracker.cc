@@ -0,0 +1,56 @@
+#include <algorithm>
+
+#include "OrderTracker.h"
+
+OrderTracker::OrderTracker (const int& width, const int& every) : width(width), every(every) {}
+
+bool OrderTracker::enabled () const {
+    return this->width > 0;
+}
+
+void OrderTracker::reset (const std::vector<Spin>& spins) {
+    if (this->width == 0) return;
+    const int area = this->width * this->width;
+    if (this->slot.size() != spins.size()) {
+        // Layers are added once, before the anneal (SQA)
+        this->slot.resize(spins.size());
+        for (int index = 0; index < (int)spins.size(); ++index) {
+            const int site    = index % area;
+            this->slot[index] = 3 * (index / area) + (site / this->width + site % this->width) % 3;
+        }
+    }
+    this->sums.assign(3 * ((spins.size() + area - 1) / area), 0);
+    for (int index = 0; index < (int)spins.size(); ++index)
+        this->sums[this->slot[index]] += (int)spins[index];
+    return;
+}
+
+int OrderTracker::getLayers () const {
+    return this->sums.size() / 3;
+}
+
+std::array<int, 3> OrderTracker::getSums (const int& layer) const {
+    return { this->sums[3 * layer], this->sums[3 * layer + 1], this->sums[3 * layer + 2] };
+}
+
+// psi = (m0 + m1 w + m2 w*) / sqrt(3) with w = exp(4 pi i / 3) and m the sublattice
+// magnetizations, so |psi|^2 = (m0^2 + m1^2 + m2^2 - m0 m1 - m1 m2 - m2 m0) / 3
+double OrderTracker::squared (const int& layer) const {
+    const double count = std::max(1, this->width * this->width / 3); // Sites per sublattice
+    const double m0 = this->sums[3 * layer] / count, m1 = this->sums[3 * layer + 1] / count,
+                 m2 = this->sums[3 * layer + 2] / count;
+    return (m0 * m0 + m1 * m1 + m2 * m2 - m0 * m1 - m1 * m2 - m2 * m0) / 3;
+}
+
+const std::vector<OrderSample>& OrderTracker::getSamples () const {
+    return this->samples;
+}
+
+void OrderTracker::sample (const double& parameter) {
+    const int layers = this->getLayers();
+    double mean      = 0.0;
+    for (int layer = 0; layer < layers; ++layer)
+        mean += this->squared(layer) / layers;
+    this->samples.push_back(OrderSample { this->sweeps, parameter, mean });
+    return;
+}
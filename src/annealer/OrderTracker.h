@@ -0,0 +1,54 @@
+#ifndef _ORDERTRACKER_H_
+#define _ORDERTRACKER_H_
+
+#include <array>
+#include <vector>
+
+#include "../include/Spin.h"
+
+struct OrderSample {
+    long sweep;       // Sweeps done when it was taken
+    double parameter; // Temperature or gamma of the sweep
+    double squared;   // |psi|^2, mean over the layers
+};
+
+/*
+ * Three-sublattice order parameter of the triangular lattice (--h-tri) while annealing. Site
+ * (i, j) of a layer of width L lies on sublattice (i + j) % 3, and the sums of the spins of
+ * every layer and sublattice follow the accepted flips, so |psi|^2 of a layer is O(1) at any
+ * moment. Disabled (width 0) every call is a single branch.
+ */
+class OrderTracker {
+  private:
+    int width = 0, every = 0; // Lattice width, sample interval in sweeps (0: never)
+    long sweeps = 0;
+    std::vector<int> slot;    // 3 * layer + sublattice of every spin
+    std::vector<int> sums;    // Spin sum of every slot
+    std::vector<OrderSample> samples;
+
+    void sample(const double&);
+
+  public:
+    OrderTracker() = default;
+    OrderTracker(const int&, const int& = 0); // width, every
+
+    // After flipping index to spin
+    inline void flip (const int& index, const Spin& spin) {
+        if (this->width == 0) return;
+        this->sums[this->slot[index]] += 2 * (int)spin;
+    }
+    // After a sweep at the given temperature or gamma
+    inline void sweep (const double& parameter) {
+        if (this->every == 0 || ++this->sweeps % this->every != 0) return;
+        this->sample(parameter);
+    }
+
+    bool enabled() const;
+    void reset(const std::vector<Spin>&); // Recount after a change that is not tracked
+    int getLayers() const;
+    std::array<int, 3> getSums(const int&) const; // Sublattice sums of a layer
+    double squared(const int&) const;             // |psi|^2 of a layer
+    const std::vector<OrderSample>& getSamples() const;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "Schedule.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static const double EXPONENTIAL_RATE = 5.0; // Decay rate k of the exponential schedule
+
+Schedule::Schedule (const Kind& k) : kind(k) {}
+
+Schedule Schedule::fromName (const std::string& name) {
+    if (name == "linear") return Schedule(LINEAR);
+    if (name == "geometric") return Schedule(GEOMETRIC);
+    if (name == "exponential") return Schedule(EXPONENTIAL);
+    if (name == "inverse-linear") return Schedule(INVERSE_LINEAR);
+    return fromFile(name);
+}
+
+Schedule Schedule::fromFile (const std::string& path) {
+    std::ifstream file(path, std::ios::in);
+    if (!file.is_open())
+        throw std::invalid_argument("Unknown schedule or unreadable schedule file " + path);
+
+    Schedule schedule(PIECEWISE);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue; // Skip comment line
+        std::stringstream ss(line);
+        double s, value;
+        if (!(ss >> s >> value) || s < 0.0 || s > 1.0)
+            throw std::runtime_error("Invalid schedule line \"" + line + "\" in " + path);
+        if (!schedule.table.empty() && s < schedule.table.back().first)
+            throw std::runtime_error("Schedule points must be sorted by s in " + path);
+        schedule.table.push_back({ s, value });
+    }
+    if (schedule.table.empty()) throw std::runtime_error("Empty schedule file " + path);
+    return schedule;
+}
+
+Schedule::Kind Schedule::getKind () const {
+    return this->kind;
+}
+
+void Schedule::check (const double& from, const double& to) const {
+    if ((kind == GEOMETRIC || kind == INVERSE_LINEAR) && (from <= 0.0 || to <= 0.0))
+        throw std::invalid_argument(
+            "Geometric and inverse-linear schedules need positive initial and final values");
+    return;
+}
+
+double Schedule::at (const double& s, const double& from, const double& to) const {
+    switch (kind) {
+        case GEOMETRIC: return from * std::pow(to / from, s);
+        case EXPONENTIAL:
+            {
+                const double tail = std::exp(-EXPONENTIAL_RATE);
+                return to + (from - to) * (std::exp(-EXPONENTIAL_RATE * s) - tail) / (1 - tail);
+            }
+        case INVERSE_LINEAR: return 1 / (1 / from + (1 / to - 1 / from) * s);
+        case PIECEWISE:
+            {
+                // Hold the end values outside of the table
+                if (s <= table.front().first) return table.front().second;
+                if (s >= table.back().first) return table.back().second;
+                auto hi = std::upper_bound(table.begin(), table.end(), s,
+                                           [] (const double& v, const std::pair<double, double>& p) {
+                                               return v < p.first;
+                                           });
+                auto lo = hi - 1;
+                if (hi->first == lo->first) return hi->second;
+                const double w = (s - lo->first) / (hi->first - lo->first);
+                return lo->second + (hi->second - lo->second) * w;
+            }
+        case LINEAR:
+        default: return from * (1 - s) + to * s;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef _SCHEDULE_H_
+#define _SCHEDULE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Annealing schedule of the temperature (SA) or the transverse field (SQA), evaluated at the
+ * fraction s in [0, 1] of the run so the same schedule serves any tau:
+ *   linear          from + (to - from) * s
+ *   geometric       from * (to / from)^s                  (from, to > 0)
+ *   exponential     to + (from - to) * (e^{-k s} - e^{-k}) / (1 - e^{-k}), k = 5
+ *   inverse-linear  1 / (1 / from + (1 / to - 1 / from) * s), linear in beta   (from, to > 0)
+ *   piecewise       linear interpolation of a "s value" table read from a file
+ */
+class Schedule {
+  public:
+    enum Kind { LINEAR, GEOMETRIC, EXPONENTIAL, INVERSE_LINEAR, PIECEWISE };
+
+  private:
+    Kind kind = LINEAR;
+    std::vector<std::pair<double, double> > table; // (s, value), s ascending (PIECEWISE)
+
+  public:
+    Schedule() = default;
+    Schedule(const Kind&);
+
+    static Schedule fromName(const std::string&); // Name above or a table file path
+    static Schedule fromFile(const std::string&); // Throws on unreadable or malformed tables
+
+    Kind getKind() const;
+    void check(const double&, const double&) const; // Throws if from / to do not fit the kind
+    double at(const double&, const double&,
+              const double&) const; // s, from, to (ignored by PIECEWISE)
+};
+
+#endif
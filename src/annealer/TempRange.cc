@@ -0,0 +1,67 @@
+#include "TempRange.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const int MIN_SAMPLES = 1024; // Random configurations are drawn until this many flips
+static const int MAX_CONFIGS = 64;
+static const double ROUNDOFF  = 1e-9; // Relative size under which a delta E is rounding noise
+
+// Median uphill delta E of the +-1 triangular lattice, the scale the SQA defaults are tuned for
+static const double TRI_MEDIAN_UPHILL = 4.0;
+static const double TRI_INIT_G        = 0.2;
+
+std::vector<double> sampleUphill (Graph graph, std::mt19937& generator) {
+    std::vector<double> samples;
+    const int total = graph.getSpins().size();
+    std::bernoulli_distribution coin(0.5);
+    for (int c = 0; c < MAX_CONFIGS && samples.size() < MIN_SAMPLES; ++c) {
+        for (int i = 0; i < total; ++i)
+            graph.setSpin(i, coin(generator) ? 1 : -1);
+        for (int i = 0; i < total; ++i) {
+            const double delta_E = graph.getHamiltonianDifference(i);
+            if (delta_E > 0.0) samples.push_back(delta_E);
+        }
+    }
+    if (samples.empty()) return samples;
+    const double cutoff = ROUNDOFF * *std::max_element(samples.begin(), samples.end());
+    samples.erase(std::remove_if(samples.begin(), samples.end(),
+                                 [cutoff] (const double& d) { return d <= cutoff; }),
+                  samples.end());
+    return samples;
+}
+
+// Mean acceptance exp(-delta_E / T) of the samples
+static double meanAccept (const std::vector<double>& samples, const double& T) {
+    double sum = 0.0;
+    for (const double& d : samples)
+        sum += std::exp(-d / T);
+    return sum / samples.size();
+}
+
+TempRange autoTempRange (const std::vector<double>& samples, const double& p_init,
+                         const double& p_final) {
+    const double lo_dE = *std::min_element(samples.begin(), samples.end());
+    const double hi_dE = *std::max_element(samples.begin(), samples.end());
+
+    // The mean acceptance grows with T, bisect on log T
+    double lo = std::log(lo_dE * 1e-3), hi = std::log(hi_dE * 1e3);
+    for (int it = 0; it < 100; ++it) {
+        const double mid = (lo + hi) / 2;
+        if (meanAccept(samples, std::exp(mid)) < p_init) lo = mid;
+        else hi = mid;
+    }
+    const double init = std::exp(hi);
+
+    // exp(-lo_dE / T) = p_final
+    const double final = std::min(init, lo_dE / std::log(1 / p_final));
+    return TempRange { init, final };
+}
+
+// Not an acceptance fit, only the scale of the tuned default follows the graph
+TempRange autoGammaRange (const std::vector<double>& samples) {
+    std::vector<double> sorted(samples);
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    const double median = sorted[sorted.size() / 2];
+    return TempRange { TRI_INIT_G * median / TRI_MEDIAN_UPHILL, 0.0 };
+}
@@ -0,0 +1,30 @@
+#ifndef _TEMPRANGE_H_
+#define _TEMPRANGE_H_
+
+#include <random>
+#include <vector>
+
+#include "../graph/Graph.h"
+
+/*
+ * Automatic schedule endpoints (--auto-temp) from the energy differences of single spin flips
+ * at random configurations:
+ *   init  the temperature at which uphill flips are accepted with mean probability p_init
+ *   final the temperature at which the smallest uphill flip is accepted with p_final
+ * SQA sweeps at a fixed temperature of 1, so no acceptance target applies to gamma: its initial
+ * value is the triangular-lattice default rescaled by the median uphill delta E, the final one 0.
+ */
+struct TempRange {
+    double init;
+    double final;
+};
+
+const double AUTO_ACCEPT_INIT  = 0.5;   // Default acceptance of uphill flips on the first step
+const double AUTO_ACCEPT_FINAL = 0.001; // Default acceptance of the smallest uphill flip at the end
+
+std::vector<double> sampleUphill(Graph, std::mt19937&); // Positive delta E of random configs
+TempRange autoTempRange(const std::vector<double>&, const double&,
+                        const double&); // samples, p_init, p_final
+TempRange autoGammaRange(const std::vector<double>&); // SQA gamma range, ignores p_init / p_final
+
+#endif
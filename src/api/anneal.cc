@@ -0,0 +1,477 @@
+#include "anneal.h"
+#include "internal.h"
+
+#include "../algo/pa/pa.h"
+#include "../algo/sa/sa.h"
+#include "../algo/sqa/sqa.h"
+#include "../algo/tabu/tabu.h"
+#include "../graph/Graph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+thread_local std::string LAST_ERROR;
+
+int fail (const int& status, const std::string& message) {
+    LAST_ERROR = message;
+    return status;
+}
+
+// Options of a solver, unset ones keep the defaults of the engine
+struct Options {
+    std::optional<int> tau, seed, sweeps_per_step, layers, tenure, starts, population;
+    std::optional<double> init, final, gamma;
+    std::optional<Schedule> schedule;
+    cluster::Kind cluster_move = cluster::NONE;
+    int replicas = 1, workers = 1, threads = 1, stagnation = 0;
+    bool polish = false, worldline = false;
+    double time_limit = 0.0;
+    std::optional<double> target_energy;
+};
+
+// Smallest value of an int option, nothing for an unknown key
+std::optional<int> intMinimum (const std::string& key) {
+    if (key == "seed") return INT32_MIN;
+    if (key == "tau" || key == "tenure" || key == "stagnation" || key == "polish" ||
+        key == "worldline")
+        return 0;
+    if (key == "replicas" || key == "workers" || key == "threads" || key == "sweeps_per_step" ||
+        key == "layers" || key == "starts" || key == "population")
+        return 1;
+    return std::nullopt;
+}
+
+struct Result {
+    double energy;
+    std::vector<Spin> spins;
+};
+
+// Anneal a single replica of the graph
+template <typename A, typename P>
+Result anneal (const Graph& graph, const P& params, const Options& o, const int& replica,
+               const double& time_limit, const std::shared_ptr<std::atomic<bool> >& cancel) {
+    A anlr(graph, params);
+    if (o.seed) anlr.setSeed(*o.seed + replica);
+    StopPolicy stop;
+    stop.time_limit = time_limit;
+    stop.stagnation = o.stagnation;
+    if (o.target_energy) {
+        stop.has_target    = true;
+        stop.target_energy = *o.target_energy;
+    }
+    anlr.setStop(stop);
+    anlr.setCancel(cancel);
+    anlr.anneal();
+    if (o.polish) anlr.polish();
+    if constexpr (std::is_same<A, Anlr_SQA>::value)
+        return Result { anlr.getBestEnergy(), anlr.getBestSpins() };
+    else return Result { anlr.getHamiltonianEnergy(), anlr.getSpins() };
+}
+
+template <typename P>
+void setSchedule (const Options& o, P& params) {
+    if (o.tau) params.tau = *o.tau;
+    if (o.schedule) params.schedule = *o.schedule;
+    if (o.sweeps_per_step) params.sweeps_per_step = *o.sweeps_per_step;
+    return;
+}
+
+Result annealReplica (const int& engine, const Options& o, const Graph& graph, const int& replica,
+                      const double& time_limit,
+                      const std::shared_ptr<std::atomic<bool> >& cancel) {
+    switch (engine) {
+        case ANNEAL_SA:
+            {
+                Params_SA params = { .rank = replica };
+                setSchedule(o, params);
+                if (o.init) params.init_t = *o.init;
+                if (o.final) params.final_t = *o.final;
+                params.cluster_move = o.cluster_move;
+                params.threads      = o.threads;
+                return anneal<Anlr_SA>(graph, params, o, replica, time_limit, cancel);
+            }
+        case ANNEAL_SQA:
+            {
+                Params_SQA params = { .rank = replica };
+                setSchedule(o, params);
+                if (o.init) params.init_g = *o.init;
+                if (o.final) params.final_g = *o.final;
+                if (o.gamma) params.gamma = *o.gamma;
+                if (o.layers) params.layer_count = *o.layers;
+                params.worldline = o.worldline;
+                return anneal<Anlr_SQA>(graph, params, o, replica, time_limit, cancel);
+            }
+        case ANNEAL_TABU:
+            {
+                Params_TABU params = { .rank = replica };
+                if (o.tau) params.tau = *o.tau;
+                if (o.tenure) params.tenure = *o.tenure;
+                if (o.starts) params.starts = *o.starts;
+                params.threads = o.threads;
+                return anneal<Anlr_TABU>(graph, params, o, replica, time_limit, cancel);
+            }
+        default:
+            {
+                Params_PA params = { .rank = replica };
+                setSchedule(o, params);
+                if (o.init) params.init_t = *o.init;
+                if (o.final) params.final_t = *o.final;
+                if (o.population) params.population = *o.population;
+                params.threads = o.threads;
+                return anneal<Anlr_PA>(graph, params, o, replica, time_limit, cancel);
+            }
+    }
+}
+
+} // namespace
+
+struct anneal_graph {
+    Graph graph;
+    int spins;
+};
+
+struct anneal_solver {
+    int engine;
+    Options options;
+    anneal_callback callback = nullptr;
+    void *user               = nullptr;
+    std::mutex callback_lock; // The workers report one at a time
+
+    std::thread worker;                         // Thread of an asynchronous solve
+    std::atomic<bool> running;                  // From the start of a solve until its results
+    std::atomic<bool> cancelled;                // Set by anneal_cancel
+    std::shared_ptr<std::atomic<bool> > cancel; // Stops the replicas, also set on target_energy
+    int status = ANNEAL_OK;
+    std::string error;
+    std::vector<Result> results;
+
+    anneal_solver (const int& e) : engine(e), running(false), cancelled(false) {}
+
+    // Anneal every replica of the graph on the worker pool, fills results and status
+    void solve (const Graph& graph) {
+        const Options o = this->options;
+        std::vector<std::optional<Result> > done(o.replicas);
+        std::vector<std::string> errors(o.replicas);
+        const int workers = std::max(1, std::min(o.workers, o.replicas));
+        const int rounds  = (o.replicas + workers - 1) / workers;
+        std::atomic<int> next(0);
+        auto work = [&] () {
+            for (int r = next++; r < o.replicas && !this->cancel->load(); r = next++) {
+                try {
+                    done[r] = annealReplica(this->engine, o, graph, r, o.time_limit / rounds,
+                                            this->cancel);
+                    if (this->callback) {
+                        std::lock_guard<std::mutex> lock(this->callback_lock);
+                        this->callback(this->user, r, done[r]->energy);
+                    }
+                } catch (const std::exception& e) {
+                    errors[r] = e.what();
+                    this->cancel->store(true); // Every replica fails the same way
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int w = 1; w < workers; ++w)
+            pool.emplace_back(work);
+        work();
+        for (std::thread& t : pool)
+            t.join();
+
+        this->results.clear();
+        for (std::optional<Result>& result : done)
+            if (result) this->results.push_back(std::move(*result));
+        std::stable_sort(this->results.begin(), this->results.end(),
+                         [] (const Result& a, const Result& b) { return a.energy < b.energy; });
+        this->status = ANNEAL_OK;
+        this->error.clear();
+        for (const std::string& e : errors)
+            if (!e.empty()) {
+                this->status = ANNEAL_FAILED;
+                this->error  = e;
+                break;
+            }
+        if (this->status == ANNEAL_OK && this->cancelled.load()) {
+            this->status = ANNEAL_CANCELLED;
+            this->error  = "Cancelled";
+        }
+        this->running.store(false);
+        return;
+    }
+};
+
+anneal_graph *annealGraph (const Graph& graph) {
+    const int spins = graph.getSpins().size();
+    if (spins < 1) {
+        fail(ANNEAL_INVALID, "A graph needs at least one spin");
+        return nullptr;
+    }
+    return new anneal_graph { graph, spins };
+}
+
+int annealSetOption (anneal_solver *s, const std::string& key, const std::string& value) {
+    const char *v = value.c_str();
+    char *end;
+    if (intMinimum(key)) {
+        errno             = 0;
+        const long long i = std::strtoll(v, &end, 10);
+        if (value.empty() || *end != '\0' || errno != 0)
+            return fail(ANNEAL_INVALID, key + " takes an integer: " + value);
+        return anneal_solver_set_int(s, key.c_str(), i);
+    }
+    if (key == "init" || key == "final" || key == "gamma" || key == "time_limit" ||
+        key == "target_energy") {
+        const double d = std::strtod(v, &end);
+        if (value.empty() || *end != '\0')
+            return fail(ANNEAL_INVALID, key + " takes a number: " + value);
+        return anneal_solver_set_double(s, key.c_str(), d);
+    }
+    if (key == "schedule" || key == "cluster") return anneal_solver_set_string(s, key.c_str(), v);
+    return fail(ANNEAL_INVALID, "Unknown option " + key);
+}
+
+static int startSolve (anneal_solver *s, const anneal_graph *g, Graph& graph) {
+    if (s == nullptr || g == nullptr) return fail(ANNEAL_INVALID, "Null solver or graph");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    if (s->worker.joinable()) s->worker.join();
+    graph = g->graph; // Shares the terms, the caller may keep building g
+    graph.lockLength();
+    s->cancel = std::make_shared<std::atomic<bool> >(false);
+    s->cancelled.store(false);
+    s->running.store(true);
+    return ANNEAL_OK;
+}
+
+static int finish (anneal_solver *s) {
+    if (s->status != ANNEAL_OK) LAST_ERROR = s->error;
+    return s->status;
+}
+
+extern "C" {
+
+const char *anneal_last_error (void) {
+    return LAST_ERROR.c_str();
+}
+
+/* Graph */
+
+anneal_graph *anneal_graph_create (int spins) {
+    if (spins < 1) {
+        fail(ANNEAL_INVALID, "A graph needs at least one spin");
+        return nullptr;
+    }
+    anneal_graph *g = new anneal_graph { Graph(), spins };
+    g->graph.pushBack(spins - 1, 0.0); // Size the graph, spins without terms stay free
+    return g;
+}
+
+void anneal_graph_destroy (anneal_graph *g) {
+    delete g;
+}
+
+int anneal_graph_add_couplings (anneal_graph *g, size_t count, const int *i, const int *j,
+                                const double *weight) {
+    if (g == nullptr || (count > 0 && (i == nullptr || j == nullptr || weight == nullptr)))
+        return fail(ANNEAL_INVALID, "Null graph or array");
+    for (size_t k = 0; k < count; ++k)
+        if (i[k] < 0 || i[k] >= g->spins || j[k] < 0 || j[k] >= g->spins)
+            return fail(ANNEAL_INVALID,
+                        "Coupling " + std::to_string(k) + " has a spin out of range");
+    for (size_t k = 0; k < count; ++k)
+        g->graph.pushBack(i[k], j[k], weight[k]);
+    return ANNEAL_OK;
+}
+
+int anneal_graph_add_fields (anneal_graph *g, size_t count, const int *i, const double *field) {
+    if (g == nullptr || (count > 0 && (i == nullptr || field == nullptr)))
+        return fail(ANNEAL_INVALID, "Null graph or array");
+    for (size_t k = 0; k < count; ++k)
+        if (i[k] < 0 || i[k] >= g->spins)
+            return fail(ANNEAL_INVALID, "Field " + std::to_string(k) + " has a spin out of range");
+    for (size_t k = 0; k < count; ++k)
+        g->graph.pushBack(i[k], field[k]);
+    return ANNEAL_OK;
+}
+
+int anneal_graph_add_constant (anneal_graph *g, double constant) {
+    if (g == nullptr) return fail(ANNEAL_INVALID, "Null graph");
+    g->graph.pushBack(constant);
+    return ANNEAL_OK;
+}
+
+int anneal_graph_energy (const anneal_graph *g, const int8_t *spins, size_t length,
+                         double *energy) {
+    if (g == nullptr || spins == nullptr || energy == nullptr)
+        return fail(ANNEAL_INVALID, "Null graph or buffer");
+    if (length != (size_t)g->spins) return fail(ANNEAL_INVALID, "Wrong configuration length");
+    Graph graph = g->graph;
+    for (int i = 0; i < g->spins; ++i) {
+        if (spins[i] != 1 && spins[i] != -1) return fail(ANNEAL_INVALID, "Spins are -1 or +1");
+        graph.setSpin(i, spins[i]);
+    }
+    *energy = graph.getHamiltonianEnergy();
+    return ANNEAL_OK;
+}
+
+/* Solver */
+
+anneal_solver *anneal_solver_create (int engine) {
+    if (engine < ANNEAL_SA || engine > ANNEAL_PA) {
+        fail(ANNEAL_INVALID, "Unknown engine " + std::to_string(engine));
+        return nullptr;
+    }
+    return new anneal_solver(engine);
+}
+
+void anneal_solver_destroy (anneal_solver *s) {
+    if (s == nullptr) return;
+    anneal_cancel(s);
+    if (s->worker.joinable()) s->worker.join();
+    delete s;
+}
+
+int anneal_solver_set_int (anneal_solver *s, const char *key, int64_t value) {
+    if (s == nullptr || key == nullptr) return fail(ANNEAL_INVALID, "Null solver or key");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    const std::string k             = key;
+    const std::optional<int> minimum = intMinimum(k);
+    if (!minimum) return fail(ANNEAL_INVALID, "Unknown int option " + k);
+    if (value < *minimum || value > INT32_MAX)
+        return fail(ANNEAL_INVALID, k + " out of range: " + std::to_string(value));
+    const int v = (int)value;
+    Options& o  = s->options;
+    if (k == "tau") o.tau = v;
+    else if (k == "seed") o.seed = v;
+    else if (k == "replicas") o.replicas = v;
+    else if (k == "workers") o.workers = v;
+    else if (k == "threads") o.threads = v;
+    else if (k == "sweeps_per_step") o.sweeps_per_step = v;
+    else if (k == "layers") o.layers = v;
+    else if (k == "tenure") o.tenure = v;
+    else if (k == "starts") o.starts = v;
+    else if (k == "population") o.population = v;
+    else if (k == "stagnation") o.stagnation = v;
+    else if (k == "polish") o.polish = v != 0;
+    else o.worldline = v != 0;
+    return ANNEAL_OK;
+}
+
+int anneal_solver_set_double (anneal_solver *s, const char *key, double value) {
+    if (s == nullptr || key == nullptr) return fail(ANNEAL_INVALID, "Null solver or key");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    const std::string k = key;
+    Options& o          = s->options;
+    if (k == "init") o.init = value;
+    else if (k == "final") o.final = value;
+    else if (k == "gamma") o.gamma = value;
+    else if (k == "target_energy") o.target_energy = value;
+    else if (k == "time_limit") {
+        if (!(value > 0.0)) return fail(ANNEAL_INVALID, "time_limit must be positive");
+        o.time_limit = value;
+    } else return fail(ANNEAL_INVALID, "Unknown double option " + k);
+    return ANNEAL_OK;
+}
+
+int anneal_solver_set_string (anneal_solver *s, const char *key, const char *value) {
+    if (s == nullptr || key == nullptr || value == nullptr)
+        return fail(ANNEAL_INVALID, "Null solver, key or value");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    const std::string k = key;
+    try {
+        if (k == "schedule") {
+            s->options.schedule = Schedule::fromName(value);
+        } else if (k == "cluster") {
+            const cluster::Kind kind = cluster::fromName(value);
+            if (kind == cluster::KBD) return fail(ANNEAL_INVALID, "kbd needs an --h-tri lattice");
+            s->options.cluster_move = kind;
+        } else return fail(ANNEAL_INVALID, "Unknown string option " + k);
+    } catch (const std::exception& e) {
+        return fail(ANNEAL_INVALID, e.what());
+    }
+    return ANNEAL_OK;
+}
+
+int anneal_solver_set_callback (anneal_solver *s, anneal_callback callback, void *user) {
+    if (s == nullptr) return fail(ANNEAL_INVALID, "Null solver");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    s->callback = callback;
+    s->user     = user;
+    return ANNEAL_OK;
+}
+
+int anneal_solve (anneal_solver *s, const anneal_graph *g) {
+    Graph graph;
+    const int status = startSolve(s, g, graph);
+    if (status != ANNEAL_OK) return status;
+    s->solve(graph);
+    return finish(s);
+}
+
+int anneal_solve_async (anneal_solver *s, const anneal_graph *g) {
+    Graph graph;
+    const int status = startSolve(s, g, graph);
+    if (status != ANNEAL_OK) return status;
+    s->worker = std::thread([s, graph] () { s->solve(graph); });
+    return ANNEAL_OK;
+}
+
+int anneal_wait (anneal_solver *s) {
+    if (s == nullptr) return fail(ANNEAL_INVALID, "Null solver");
+    if (s->worker.joinable()) s->worker.join();
+    return finish(s);
+}
+
+int anneal_running (const anneal_solver *s) {
+    return s != nullptr && s->running.load() ? 1 : 0;
+}
+
+void anneal_cancel (anneal_solver *s) {
+    if (s == nullptr || !s->running.load()) return;
+    s->cancelled.store(true);
+    s->cancel->store(true);
+    return;
+}
+
+/* Results */
+
+int anneal_result_count (const anneal_solver *s) {
+    if (s == nullptr || s->running.load()) return 0;
+    return s->results.size();
+}
+
+int anneal_result_energy (const anneal_solver *s, int rank, double *energy) {
+    if (s == nullptr || energy == nullptr) return fail(ANNEAL_INVALID, "Null solver or buffer");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    if (rank < 0 || rank >= (int)s->results.size())
+        return fail(ANNEAL_INVALID, "No result " + std::to_string(rank));
+    *energy = s->results[rank].energy;
+    return ANNEAL_OK;
+}
+
+int anneal_result_spins (const anneal_solver *s, int rank, int8_t *spins, size_t length) {
+    if (s == nullptr || spins == nullptr) return fail(ANNEAL_INVALID, "Null solver or buffer");
+    if (s->running.load()) return fail(ANNEAL_BUSY, "A solve is running");
+    if (rank < 0 || rank >= (int)s->results.size())
+        return fail(ANNEAL_INVALID, "No result " + std::to_string(rank));
+    const std::vector<Spin>& result = s->results[rank].spins;
+    if (length < result.size())
+        return fail(ANNEAL_INVALID, "The buffer holds " + std::to_string(length) + " of " +
+                                        std::to_string(result.size()) + " spins");
+    for (size_t i = 0; i < result.size(); ++i)
+        spins[i] = (int8_t)result[i];
+    return ANNEAL_OK;
+}
+
+} // extern "C"
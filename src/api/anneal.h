@@ -0,0 +1,88 @@
+#ifndef _ANNEAL_API_H_
+#define _ANNEAL_API_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface of the annealers, for programs that link libanneal instead of running main_exe
+ * on files. A graph is built from arrays of Ising terms, E = sum w s_i s_j + sum h s_i + c, over
+ * the spins 0..N-1. A solver holds the engine and its options, anneals a graph (blocking or on
+ * a thread of its own) and keeps one result per replica, lowest energy first, until the next
+ * solve. Spins are copied out as -1 / +1 into buffers of the caller.
+ *
+ * Functions returning int return ANNEAL_OK or a negative status, anneal_last_error then holds
+ * the message. A graph or solver is used by one thread at a time, different ones are
+ * independent. The handles and the status values are all the ABI exposes, so options are set
+ * by name and new ones do not change it.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Status */
+#define ANNEAL_OK 0
+#define ANNEAL_INVALID -1   /* Bad argument or option */
+#define ANNEAL_BUSY -2      /* The solver is running an asynchronous solve */
+#define ANNEAL_FAILED -3    /* The solve failed */
+#define ANNEAL_CANCELLED -4 /* anneal_cancel stopped the solve, the replicas started keep a result */
+
+/* Engines, as --func */
+#define ANNEAL_SA 0
+#define ANNEAL_SQA 1
+#define ANNEAL_TABU 2
+#define ANNEAL_PA 3
+
+typedef struct anneal_graph anneal_graph;
+typedef struct anneal_solver anneal_solver;
+
+/* Called as each replica finishes, by one solving thread at a time: (user, replica, energy) */
+typedef void (*anneal_callback)(void *, int, double);
+
+const char *anneal_last_error(void); /* Message of the last failure on the calling thread */
+
+/* Graph */
+anneal_graph *anneal_graph_create(int spins); /* NULL if spins < 1 */
+void anneal_graph_destroy(anneal_graph *);
+int anneal_graph_add_couplings(anneal_graph *, size_t count, const int *i, const int *j,
+                               const double *weight); /* w s_i s_j for every k < count */
+int anneal_graph_add_fields(anneal_graph *, size_t count, const int *i,
+                            const double *field); /* h s_i for every k < count */
+int anneal_graph_add_constant(anneal_graph *, double);
+int anneal_graph_energy(const anneal_graph *, const int8_t *spins, size_t length,
+                        double *energy); /* Energy of a configuration of every spin */
+
+/*
+ * Solver options, by name:
+ *   int     tau, seed, replicas, workers (replicas annealed at once), threads, sweeps_per_step,
+ *           layers, tenure, starts, population, stagnation, polish, worldline
+ *   double  init, final (temperature, or gamma for SQA), gamma, time_limit (seconds for the
+ *           whole solve), target_energy
+ *   string  schedule (a name of --schedule or a table file), cluster (sw or wolff)
+ * Unset options keep the defaults of main_exe, replica r draws from seed + r.
+ */
+anneal_solver *anneal_solver_create(int engine); /* NULL for an unknown engine */
+void anneal_solver_destroy(anneal_solver *);     /* Cancels and waits for a running solve */
+int anneal_solver_set_int(anneal_solver *, const char *key, int64_t value);
+int anneal_solver_set_double(anneal_solver *, const char *key, double value);
+int anneal_solver_set_string(anneal_solver *, const char *key, const char *value);
+int anneal_solver_set_callback(anneal_solver *, anneal_callback, void *user);
+
+/* Solve, the graph is copied so it can change or go as soon as these return */
+int anneal_solve(anneal_solver *, const anneal_graph *);       /* Blocks until done */
+int anneal_solve_async(anneal_solver *, const anneal_graph *); /* Returns at once */
+int anneal_wait(anneal_solver *);          /* Blocks until the solve is done, returns its status */
+int anneal_running(const anneal_solver *); /* 1 while an asynchronous solve runs */
+void anneal_cancel(anneal_solver *);       /* Stops the replicas at their next schedule step */
+
+/* Results of the last solve, lowest energy first */
+int anneal_result_count(const anneal_solver *);
+int anneal_result_energy(const anneal_solver *, int rank, double *energy);
+int anneal_result_spins(const anneal_solver *, int rank, int8_t *spins, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
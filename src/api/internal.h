@@ -0,0 +1,16 @@
+#ifndef _ANNEAL_API_INTERNAL_H_
+#define _ANNEAL_API_INTERNAL_H_
+
+#include "../graph/Graph.h"
+#include "anneal.h"
+
+#include <string>
+
+/*
+ * For the in-tree callers of the C interface (--serve, --jobs), not exported by libanneal.so.
+ */
+anneal_graph *annealGraph(const Graph&); // Handle sharing the terms, NULL without spins
+int annealSetOption(anneal_solver *, const std::string&,
+                    const std::string&); // key, value as text, parsed as the type of the key
+
+#endif
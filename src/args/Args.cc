@@ -1,4 +1,5 @@
 #include "./Args.h"
+#include "../algo/cluster/cluster.h"
 
 #include <iostream>
 #include <vector>
@@ -26,13 +27,46 @@ std::vector<ArgFormat> CustomArgs::argsConstruct () const {
         { "--final-t", ARG_DOUBLE, 1 }, // Specify a final temperature value
         { "--tau", ARG_INT, 1 }, // Specify a tau for annealer
         { "--func", ARG_STRING,
-         1 }, // Either "sa" for simulated annealing or "sqa" for simulated quantum annealing
+         1 }, // "sa", "sqa" (simulated quantum annealing), "tabu", "pa" (population annealing) or "wl"
         { "--height", ARG_INT,
          1 }, // Specify a height for triangular lattice ( When annealing with func sqa ) default 4
         { "--ans-count", ARG_INT, 1 }, // Specify a number of answers to be returned
         { "--print-conf", ARG_BOOL, 0 }, // Print the configuration
         { "--print-progress", ARG_BOOL, 0 }, // Print the configuration
         { "--spin-conf", ARG_STRING, 1 }, // Initialize spins from file
+        { "--partition", ARG_BOOL, 0 }, // Split the graph across MPI ranks
+        { "--seed", ARG_INT, 1 }, // Seed of the random generator ( replica r uses seed + r )
+        { "--checkpoint", ARG_STRING, 1 }, // Checkpoint file prefix
+        { "--checkpoint-every", ARG_INT, 1 }, // Checkpoint every N sweeps
+        { "--checkpoint-secs", ARG_DOUBLE, 1 }, // Checkpoint every T seconds
+        { "--resume", ARG_STRING, 1 }, // Resume from the checkpoint prefix
+        { "--profile", ARG_STRING, 1 }, // Write the run profile as JSON
+        { "--schedule", ARG_STRING, 1 }, // Schedule name or piecewise table file
+        { "--sweeps-per-step", ARG_INT, 1 }, // Sweeps at every schedule step
+        { "--auto-temp", ARG_BOOL, 0 }, // Derive the temperature / gamma range from the graph
+        { "--auto-accept", ARG_VD, 2 }, // Initial and final acceptance targets of --auto-temp
+        { "--time-limit", ARG_DOUBLE, 1 }, // Wall-clock budget in seconds
+        { "--stop-on-stagnation", ARG_INT, 1 }, // Stop after N sweeps without a better energy
+        { "--target-energy", ARG_DOUBLE, 1 }, // Stop once this energy is reached
+        { "--polish", ARG_BOOL, 0 }, // Steepest descent of every replica after annealing
+        { "--tenure", ARG_INT, 1 }, // Moves a flipped spin stays tabu ( func tabu )
+        { "--starts", ARG_INT, 1 }, // Independent starts of every replica ( func tabu )
+        { "--threads", ARG_INT, 1 }, // Worker threads of every replica
+        { "--population", ARG_INT, 1 }, // Replicas cooled together ( func pa )
+        { "--windows", ARG_INT, 1 }, // Energy windows of the walkers ( func wl )
+        { "--flatness", ARG_DOUBLE, 1 }, // Flat histogram criterion ( func wl )
+        { "--final-lnf", ARG_DOUBLE, 1 }, // ln f at which a window is done ( func wl )
+        { "--worldline", ARG_BOOL, 0 }, // Worldline cluster moves after every sweep ( func sqa )
+        { "--houdayer", ARG_BOOL, 0 }, // Houdayer moves between replica pairs ( mpi, func sa )
+        { "--cluster", ARG_STRING, 1 }, // sw, wolff or kbd cluster move every sweep ( func sa )
+        { "--preprocess", ARG_BOOL, 0 }, // Fix spins and anneal components ( func sa, tabu )
+        { "--reorder", ARG_STRING, 1 }, // bfs or rcm relabeling of the --file spins
+        { "--op-every", ARG_INT, 1 }, // Sample the --h-tri order parameter every N sweeps
+        { "--measure", ARG_INT, 1 }, // Sample N sweeps at the initial temperature / gamma
+        { "--thermalize", ARG_INT, 1 }, // Sweeps before the samples of --measure
+        { "--serve", ARG_STRING, 1 }, // Answer annealing jobs on a unix socket
+        { "--jobs", ARG_STRING, 1 }, // Anneal the job grids of a file, one table of results
+        { "--workers", ARG_INT, 1 }, // Jobs annealed at once ( --serve, --jobs )
         { "--help", ARG_BOOL, 0, false }, // Display help
     });
 };
@@ -43,21 +77,176 @@ std::vector<struct argparse::ArgConstraint> CustomArgs::argsConstraint () const
         // { "--qubo", "--file", COEXIST },
         { "--h-tri", "--file", MUTEX },
         { "--h-tri", "--qubo", MUTEX },
+        { "--partition", "--spin-conf", MUTEX },
+        { "--resume", "--spin-conf", MUTEX },
+        { "--checkpoint-every", "--checkpoint", REQUIRE },
+        { "--checkpoint-secs", "--checkpoint", REQUIRE },
+        { "--auto-accept", "--auto-temp", REQUIRE },
+        { "--auto-temp", "--partition", MUTEX },
+        { "--polish", "--partition", MUTEX },
+        { "--houdayer", "--partition", MUTEX },
+        { "--cluster", "--partition", MUTEX },
+        { "--preprocess", "--partition", MUTEX },
+        { "--serve", "--file", MUTEX },
+        { "--serve", "--h-tri", MUTEX },
+        { "--serve", "--partition", MUTEX },
+        { "--jobs", "--file", MUTEX },
+        { "--jobs", "--h-tri", MUTEX },
+        { "--jobs", "--partition", MUTEX },
+        { "--jobs", "--serve", MUTEX },
+        { "--preprocess", "--spin-conf", MUTEX },
+        { "--preprocess", "--checkpoint", MUTEX },
+        { "--preprocess", "--resume", MUTEX },
+        { "--preprocess", "--target-energy", MUTEX },
+        { "--reorder", "--h-tri", MUTEX },
+        { "--reorder", "--partition", MUTEX },
+        { "--op-every", "--h-tri", REQUIRE },
+        { "--op-every", "--partition", MUTEX },
+        { "--op-every", "--preprocess", MUTEX },
+        { "--thermalize", "--measure", REQUIRE },
+        { "--measure", "--partition", MUTEX },
+        { "--measure", "--preprocess", MUTEX },
+        { "--measure", "--houdayer", MUTEX },
+        { "--measure", "--checkpoint", MUTEX },
+        { "--measure", "--resume", MUTEX },
+        { "--measure", "--schedule", MUTEX },
+        { "--measure", "--sweeps-per-step", MUTEX },
+        { "--measure", "--time-limit", MUTEX },
+        { "--measure", "--stop-on-stagnation", MUTEX },
+        { "--measure", "--target-energy", MUTEX },
+        { "--measure", "--op-every", MUTEX },
         // { "--h-tri", "--ini-g", REQUIRE },
     });
 }
 
 void CustomArgs::customConstraintsCheck () const {
-    if (!this->hasArg("--h-tri") && !this->hasArg("--file")) {
-        throw std::invalid_argument("Either --h-tri or --file must be specified");
+    if (!this->hasArg("--h-tri") && !this->hasArg("--file") && !this->hasArg("--serve") &&
+        !this->hasArg("--jobs")) {
+        throw std::invalid_argument("Either --h-tri, --file, --serve or --jobs must be specified");
     }
     if (this->hasArg("--func")) {
         const std::string func = std::get<std::string>(this->getArg("--func"));
-        if (func != "sa" && func != "sqa") {
+        if (func != "sa" && func != "sqa" && func != "tabu" && func != "pa" && func != "wl") {
             std::cout << func << "is not a valid function option" << std::endl;
             throw std::invalid_argument("Invalid function specified");
         }
     }
+    const ANNEAL_FUNC strategy = this->getStrategy();
+    if (this->hasArg("--partition") && strategy != ANNEAL_FUNC::SA &&
+        strategy != ANNEAL_FUNC::NIL) {
+        throw std::invalid_argument("--partition only supports --func sa");
+    }
+    if (this->hasArg("--sweeps-per-step") && std::get<int>(this->getArg("--sweeps-per-step")) < 1) {
+        throw std::invalid_argument("--sweeps-per-step must be at least 1");
+    }
+    if (this->hasArg("--time-limit") && std::get<double>(this->getArg("--time-limit")) <= 0.0) {
+        throw std::invalid_argument("--time-limit must be positive");
+    }
+    if ((strategy == ANNEAL_FUNC::TABU || strategy == ANNEAL_FUNC::PA ||
+         strategy == ANNEAL_FUNC::WL) &&
+        (this->hasArg("--checkpoint") || this->hasArg("--resume"))) {
+        throw std::invalid_argument("--func tabu, pa and wl do not support checkpoints");
+    }
+    if (strategy != ANNEAL_FUNC::TABU && (this->hasArg("--tenure") || this->hasArg("--starts"))) {
+        throw std::invalid_argument("--tenure and --starts only apply to --func tabu");
+    }
+    if (strategy != ANNEAL_FUNC::SQA && this->hasArg("--worldline")) {
+        throw std::invalid_argument("--worldline only applies to --func sqa");
+    }
+    if (this->hasArg("--houdayer")) {
+#ifndef USE_MPI
+        throw std::invalid_argument("--houdayer pairs MPI ranks, it needs the MPI build");
+#endif
+        if (strategy != ANNEAL_FUNC::SA && strategy != ANNEAL_FUNC::NIL)
+            throw std::invalid_argument("--houdayer only applies to --func sa");
+    }
+    if (this->hasArg("--cluster")) {
+        if (strategy != ANNEAL_FUNC::SA && strategy != ANNEAL_FUNC::NIL)
+            throw std::invalid_argument("--cluster only applies to --func sa");
+        const std::string name = std::get<std::string>(this->getArg("--cluster"));
+        if (cluster::fromName(name) == cluster::KBD && !this->hasArg("--h-tri"))
+            throw std::invalid_argument("--cluster kbd needs the --h-tri lattice");
+    }
+    if (this->hasArg("--preprocess")) {
+        if (strategy != ANNEAL_FUNC::SA && strategy != ANNEAL_FUNC::NIL &&
+            strategy != ANNEAL_FUNC::TABU)
+            throw std::invalid_argument("--preprocess only applies to --func sa and tabu");
+        if (this->hasArg("--cluster") &&
+            std::get<std::string>(this->getArg("--cluster")) == "kbd")
+            throw std::invalid_argument("--preprocess breaks up the lattice of --cluster kbd");
+    }
+    if (this->hasArg("--reorder")) {
+        const std::string method = std::get<std::string>(this->getArg("--reorder"));
+        if (method != "bfs" && method != "rcm")
+            throw std::invalid_argument("Unknown --reorder " + method + ", expected bfs or rcm");
+    }
+    if (this->hasArg("--op-every")) {
+        if (strategy != ANNEAL_FUNC::SA && strategy != ANNEAL_FUNC::SQA &&
+            strategy != ANNEAL_FUNC::NIL)
+            throw std::invalid_argument("--op-every only applies to --func sa and sqa");
+        if (std::get<int>(this->getArg("--op-every")) < 1)
+            throw std::invalid_argument("--op-every must be at least 1");
+    }
+    if (this->hasArg("--measure")) {
+        if (strategy != ANNEAL_FUNC::SA && strategy != ANNEAL_FUNC::SQA &&
+            strategy != ANNEAL_FUNC::NIL)
+            throw std::invalid_argument("--measure only applies to --func sa and sqa");
+        if (std::get<int>(this->getArg("--measure")) < 1)
+            throw std::invalid_argument("--measure must be at least 1 sweep");
+        if (this->hasArg("--thermalize") && std::get<int>(this->getArg("--thermalize")) < 0)
+            throw std::invalid_argument("--thermalize must not be negative");
+    }
+    if (strategy == ANNEAL_FUNC::PA && this->hasArg("--spin-conf")) {
+        throw std::invalid_argument("--func pa starts from random replicas, not --spin-conf");
+    }
+    if (this->hasArg("--population") &&
+        (strategy != ANNEAL_FUNC::PA || std::get<int>(this->getArg("--population")) < 1)) {
+        throw std::invalid_argument("--population needs --func pa and at least 1 replica");
+    }
+    if (strategy == ANNEAL_FUNC::WL) {
+        // The walkers start from the anneals of the range and follow no schedule
+        for (const char *arg : { "--spin-conf", "--polish", "--auto-temp", "--schedule",
+                                 "--sweeps-per-step", "--stop-on-stagnation", "--target-energy" })
+            if (this->hasArg(arg))
+                throw std::invalid_argument(std::string("--func wl does not take ") + arg);
+    }
+    if (strategy != ANNEAL_FUNC::WL &&
+        (this->hasArg("--windows") || this->hasArg("--flatness") || this->hasArg("--final-lnf"))) {
+        throw std::invalid_argument("--windows, --flatness and --final-lnf only apply to --func wl");
+    }
+    if (this->hasArg("--windows") && std::get<int>(this->getArg("--windows")) < 1) {
+        throw std::invalid_argument("--windows must be at least 1");
+    }
+    if (this->hasArg("--flatness")) {
+        const double p = std::get<double>(this->getArg("--flatness"));
+        if (!(0.0 < p && p < 1.0)) throw std::invalid_argument("--flatness must be in (0, 1)");
+    }
+    if (this->hasArg("--final-lnf") && std::get<double>(this->getArg("--final-lnf")) <= 0.0) {
+        throw std::invalid_argument("--final-lnf must be positive");
+    }
+    if (this->hasArg("--starts") && std::get<int>(this->getArg("--starts")) < 1) {
+        throw std::invalid_argument("--starts must be at least 1");
+    }
+    if (this->hasArg("--threads") && std::get<int>(this->getArg("--threads")) < 1) {
+        throw std::invalid_argument("--threads must be at least 1");
+    }
+#ifdef USE_MPI
+    if (this->hasArg("--serve") || this->hasArg("--jobs")) {
+        throw std::invalid_argument("--serve and --jobs need the serial build, the MPI annealers "
+                                    "exchange replicas with the other ranks");
+    }
+#endif
+    if (this->hasArg("--workers") && !this->hasArg("--serve") && !this->hasArg("--jobs")) {
+        throw std::invalid_argument("--workers only applies to --serve and --jobs");
+    }
+    if (this->hasArg("--workers") && std::get<int>(this->getArg("--workers")) < 1) {
+        throw std::invalid_argument("--workers must be at least 1");
+    }
+    if (this->hasArg("--auto-accept")) {
+        const std::vector<double> p = std::get<std::vector<double> >(this->getArg("--auto-accept"));
+        if (!(0.0 < p[1] && p[1] < p[0] && p[0] < 1.0))
+            throw std::invalid_argument("--auto-accept needs 0 < final < initial < 1");
+    }
     // if (this->hasArg("--func") && std::get<std::string>(this->getArg("--func")) == "sqa") {
     //     if (this->hasArg("--h-tri") && std::get<std::vector<int> >(this->getArg("--h-tri"))[1] <=
     //     1) {
@@ -71,6 +260,9 @@ ANNEAL_FUNC CustomArgs::getStrategy () const {
     if (!this->hasArg("--func")) return ANNEAL_FUNC::NIL;
     if (std::get<std::string>(this->getArg("--func")) == "sa") return ANNEAL_FUNC::SA;
     if (std::get<std::string>(this->getArg("--func")) == "sqa") return ANNEAL_FUNC::SQA;
+    if (std::get<std::string>(this->getArg("--func")) == "tabu") return ANNEAL_FUNC::TABU;
+    if (std::get<std::string>(this->getArg("--func")) == "pa") return ANNEAL_FUNC::PA;
+    if (std::get<std::string>(this->getArg("--func")) == "wl") return ANNEAL_FUNC::WL;
     return NIL;
 }
 
@@ -86,11 +278,44 @@ void CustomArgs::outputHelp () const {
     std::cout << "  --ini-t <temp>             Specify an initial temperature value" << std::endl;
     std::cout << "  --final-t <temp>           Specify an final temperature value" << std::endl;
     std::cout << "  --tau <tau>                Specify a tau for annealer" << std::endl;
-    std::cout << "  --func <func_string>       Specify a function for annealer, either \"sa\" or \"sqa\" " << std::endl;
+    std::cout << "  --func <func_string>       Specify a function for annealer, \"sa\", \"sqa\", \"tabu\", \"pa\" or \"wl\" " << std::endl;
     std::cout << "  --height <height>          Specify a height for triangular lattice ( When annealing with func sqa ) default 8" << std::endl;
     std::cout << "  --print-conf               Output the configuration" << std::endl;
     std::cout << "  --print-progress           Print the annealing progress" << std::endl;
     std::cout << "  --spin-conf <file>         Initialize spins from file" << std::endl;
+    std::cout << "  --partition                Split the graph across MPI ranks ( mpi build, func sa )" << std::endl;
+    std::cout << "  --seed <seed>              Seed the random generator, replica r uses seed + r" << std::endl;
+    std::cout << "  --checkpoint <prefix>      Write binary checkpoints to <prefix>.<rank>" << std::endl;
+    std::cout << "  --checkpoint-every <n>     Checkpoint every n sweeps ( default 1000 )" << std::endl;
+    std::cout << "  --checkpoint-secs <sec>    Checkpoint every sec seconds" << std::endl;
+    std::cout << "  --resume <prefix>          Resume every replica from <prefix>.<rank>" << std::endl;
+    std::cout << "  --profile <file>           Write timers and counters of the run to file as JSON" << std::endl;
+    std::cout << "  --schedule <name|file>     linear ( default ), geometric, exponential, inverse-linear or a \"s value\" table file" << std::endl;
+    std::cout << "  --sweeps-per-step <n>      Sweeps at every step of the schedule ( default 1 )" << std::endl;
+    std::cout << "  --auto-temp                Derive the initial / final temperature from sampled flip energies ( for sqa only rescales the default gamma )" << std::endl;
+    std::cout << "  --auto-accept <p0> <pf>    Acceptance targets of --auto-temp ( default 0.5 0.001 )" << std::endl;
+    std::cout << "  --time-limit <sec>         Fit the schedule to a wall-clock budget instead of tau" << std::endl;
+    std::cout << "  --stop-on-stagnation <n>   Stop once the best energy has not improved for n sweeps" << std::endl;
+    std::cout << "  --target-energy <energy>   Stop ( every replica ) once a replica reaches energy" << std::endl;
+    std::cout << "  --polish                   Descend every replica to a local minimum of single flips before output" << std::endl;
+    std::cout << "  --tenure <n>               Moves a flipped spin stays tabu ( func tabu, default min(20, spins / 4) )" << std::endl;
+    std::cout << "  --starts <n>               Independent starts of every replica, the best is kept ( func tabu )" << std::endl;
+    std::cout << "  --threads <n>              Worker threads of every replica ( default 1 )" << std::endl;
+    std::cout << "  --population <n>           Replicas cooled together ( func pa, default 1000 )" << std::endl;
+    std::cout << "  --windows <n>              Overlapping energy windows, one walker each ( func wl, default --threads )" << std::endl;
+    std::cout << "  --flatness <p>             A histogram is flat once its lowest bin reaches p of its mean ( func wl, default 0.8 )" << std::endl;
+    std::cout << "  --final-lnf <lnf>          Modification factor ln f at which a window is done ( func wl, default 1e-6 )" << std::endl;
+    std::cout << "  --worldline                Flip segments of Trotter worldlines after every sweep ( func sqa )" << std::endl;
+    std::cout << "  --houdayer                 Houdayer cluster moves between rank pairs every step ( mpi, func sa )" << std::endl;
+    std::cout << "  --cluster <sw|wolff|kbd>   Cluster move after every sweep, kbd for the --h-tri lattice ( func sa )" << std::endl;
+    std::cout << "  --preprocess               Fix spins by dominance and roof duality, anneal the connected components apart ( func sa, tabu )" << std::endl;
+    std::cout << "  --reorder <bfs|rcm>        Relabel the --file spins so neighbours sit close in memory, conf files keep the input indices" << std::endl;
+    std::cout << "  --op-every <n>             Write the order parameter of the --h-tri lattice every n sweeps to op_*.tsv ( func sa, sqa )" << std::endl;
+    std::cout << "  --measure <n>              Sample n sweeps at --ini-t ( --ini-g for sqa ) instead of annealing, write the estimates to measure_*.tsv" << std::endl;
+    std::cout << "  --thermalize <n>           Sweeps before the samples of --measure ( default n / 10 )" << std::endl;
+    std::cout << "  --serve <socket>           Load instances and anneal the jobs of clients on a unix socket, see src/serve/serve.h" << std::endl;
+    std::cout << "  --jobs <file>              Anneal the instance x parameter grids of file, see src/jobs/jobs.h" << std::endl;
+    std::cout << "  --workers <n>              Jobs annealed at once by --serve or --jobs ( default the hardware threads )" << std::endl;
     std::cout << "  --help                     Display this information" << std::endl;
     // clang-format on
     exit(0);
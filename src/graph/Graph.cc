@@ -1,7 +1,10 @@
 #include "../include/Helper.h"
 #include "Graph.h"
 
+#include <algorithm>
 #include <cmath>
+#include <queue>
+#include <type_traits>
 
 #define debug(n) std::cerr << n << std::endl;
 
@@ -10,13 +13,58 @@ inline double loge (double x) {
     return std::log(x) / std::log(E);
 }
 
+static const double DESCENT_ROUNDOFF = 1e-9; // Relative size under which a delta E is noise
+
+// Built from adj_list on demand, a stored copy cost several allocations per spin
 std::map<int, std::vector<int> > Graph::getAdjMap () const {
-    return this->adj_map;
+    std::map<int, std::vector<int> > adj_map;
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i)
+        for (AdjNode *tmp = terms->adj_list[i]; tmp != nullptr; tmp = tmp->next)
+            adj_map[i].push_back(tmp->val);
+    return adj_map;
+}
+
+/* Hamiltonian */
+
+Hamiltonian::Hamiltonian () {}
+
+static std::size_t countNodes (const Hamiltonian& h) {
+    std::size_t count = 0;
+    for (AdjNode *head : h.adj_list)
+        for (AdjNode *tmp = head; tmp != nullptr; tmp = tmp->next)
+            ++count;
+    return count;
+}
+
+Hamiltonian::Hamiltonian (const Hamiltonian& h)
+    : arena(std::max<std::size_t>(countNodes(h), 1) * sizeof(AdjNode)),
+      adj_list(h.adj_list.size(), nullptr), constant_map(h.constant_map), constant(h.constant) {
+    for (int i = 0; i < (int)h.adj_list.size(); ++i) {
+        AdjNode **tail = &this->adj_list[i];
+        for (AdjNode *tmp = h.adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+            *tail = this->newNode(tmp->val, tmp->weight);
+            tail  = &(*tail)->next;
+        }
+    }
+}
+
+// The arena frees its blocks without running destructors
+static_assert(std::is_trivially_destructible<AdjNode>::value, "AdjNode is freed with the arena");
+AdjNode *Hamiltonian::newNode (const int& val, const double& weight) {
+    return new (this->arena.allocate(sizeof(AdjNode), alignof(AdjNode))) AdjNode(val, weight);
 }
 
 /* Private functions */
 
+// Nobody else holds the terms once this returns, so they can change in place
+Hamiltonian& Graph::mutableTerms () {
+    if (this->terms.use_count() > 1) this->terms = std::make_shared<Hamiltonian>(*this->terms);
+    // The terms are created non-const, only the pointer shared with the copies is const
+    return const_cast<Hamiltonian&>(*this->terms);
+}
+
 void Graph::privatePushBack (const int& index, AdjNode *node) {
+    std::vector<AdjNode *>& adj_list = this->mutableTerms().adj_list;
     /* Insert into adj_list */
     if (index >= adj_list.size()) { adj_list.resize(index + 1, nullptr); }
     if (adj_list[index] == nullptr) {
@@ -28,25 +76,21 @@ void Graph::privatePushBack (const int& index, AdjNode *node) {
         }
         tmp->next = node;
     }
-    /* Insert into adj_map */
-    std::map<int, std::vector<int> >::iterator it = adj_map.find(index);
-    if (it == adj_map.end()) {
-        adj_map[index] = std::vector<int>({ node->val });
-    } else {
-        it->second.push_back(node->val);
-    }
     /* Append the Spin vector */
     if (index >= spins.size()) { spins.resize(index + 1, UP); }
 }
 
 void Graph::privatePushBack (const int& index, const double& constant) {
+    Hamiltonian& h = this->mutableTerms();
     /* Insert into constant_map */
-    std::map<int, double>::iterator it = constant_map.find(index);
-    if (it == constant_map.end()) {
-        constant_map.insert(std::pair<int, double>(index, constant));
+    std::map<int, double>::iterator it = h.constant_map.find(index);
+    if (it == h.constant_map.end()) {
+        h.constant_map.insert(std::pair<int, double>(index, constant));
     } else {
         it->second += constant;
     }
+    /* Every spin has a slot in adj_list, a linear term only leaves it empty */
+    if (index >= (int)h.adj_list.size()) { h.adj_list.resize(index + 1, nullptr); }
     /* Append the Spin vector */
     if (index >= spins.size()) { spins.resize(index + 1, UP); }
     return;
@@ -64,8 +108,8 @@ std::vector<double> Graph::getVerticalEnergyProduct (const int& length) {
     std::vector<double> list_of_energy(length, 0.0);
 
     for (int i = 0; i < length; ++i) {
-        const int self_idx = adj_list[i]->val;
-        AdjNode *tmp       = adj_list[i];
+        const int self_idx = terms->adj_list[i]->val;
+        AdjNode *tmp       = terms->adj_list[i];
         int current_layer  = 0;
 
         // \sum_{i=1}^L { \sum_{l=1}^{L_tau} { s_i^l * s_i^{l+1} } }
@@ -83,9 +127,9 @@ std::vector<double> Graph::getVerticalEnergyProduct (const int& length) {
 double Graph::getHamiltonianEnergy () const {
     double sum = 0.0;
     // std::cout << "adj_list.size() = " << adj_list.size() << std::endl;
-    for (int i = 0; i < adj_list.size(); ++i) {
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i) {
         // std::cout << i << std::endl;
-        AdjNode *tmp = adj_list[i];
+        AdjNode *tmp = terms->adj_list[i];
         if (tmp == nullptr) continue;
         const double spin = (double)spins[i]; // Get spin of current node
 
@@ -102,11 +146,11 @@ double Graph::getHamiltonianEnergy () const {
         }
     }
     // Calculate the linear terms
-    for (auto const& it : constant_map) {
+    for (auto const& it : terms->constant_map) {
         sum += it.second * (double)spins[it.first];
     }
     // Calculate the constant term
-    sum += constant;
+    sum += terms->constant;
     return sum;
 }
 
@@ -115,8 +159,8 @@ std::vector<double> Graph::getLayerHamiltonianEnergy () const {
     const int height = this->spins.size() / this->length;
     std::vector<double> list_of_energy(height, 0.0);
     double current_sum = 0.0;
-    for (int i = 0; i < adj_list.size(); ++i) {
-        AdjNode *tmp = adj_list[i];
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i) {
+        AdjNode *tmp = terms->adj_list[i];
         if (tmp == nullptr) continue;
         const double spin = (double)spins[i]; // Get spin of current node
 
@@ -130,13 +174,13 @@ std::vector<double> Graph::getLayerHamiltonianEnergy () const {
         }
 
         // Refresh the current_sum if the current node is the last node of the layer
-        const int length_square = adj_list.size() / height;
+        const int length_square = terms->adj_list.size() / height;
         if ((i + 1) % length_square == 0) {
             // Calculate the linear terms
-            for (auto const& it : constant_map)
+            for (auto const& it : terms->constant_map)
                 current_sum += it.second * (double)spins[it.first];
             // Calculate the constant term
-            current_sum += constant;
+            current_sum += terms->constant;
 
             list_of_energy[i / length_square] = current_sum;
             current_sum                       = 0.0;
@@ -147,19 +191,19 @@ std::vector<double> Graph::getLayerHamiltonianEnergy () const {
     return list_of_energy;
 }
 
-// Get the Hamiltonian difference given the indices to flip and the spin
+// Get the Hamiltonian difference given the indices to flip and the spin, self loops are constant
+// and never change the energy
 double Graph::getHamiltonianDifference (const int& index) {
     double sum_to_modify = 0.0;
     const double spin    = (double)spins[index];
-    AdjNode *tmp         = adj_list[index];
+    AdjNode *tmp         = terms->adj_list[index];
     while (tmp != nullptr) {
-        sum_to_modify += tmp->weight * spin * (double)spins[tmp->val];
+        if (tmp->val != index) sum_to_modify += tmp->weight * spin * (double)spins[tmp->val];
         tmp = tmp->next;
     }
     // std::cout << -2.0 * sum_to_modify << std::endl;
-    if (constant_map.find(index) != constant_map.end()) {
-        sum_to_modify += constant_map[index] * (double)spins[index];
-    }
+    std::map<int, double>::const_iterator it = terms->constant_map.find(index);
+    if (it != terms->constant_map.end()) { sum_to_modify += it->second * (double)spins[index]; }
     return -2.0 * sum_to_modify;
 }
 
@@ -172,32 +216,19 @@ int Graph::getHeight () const {
 
 /* Constructor */
 Graph::Graph () {
-    this->adj_list     = std::vector<AdjNode *> {};
-    this->adj_map      = std::map<int, std::vector<int> > {};
-    this->constant_map = std::map<int, double> {};
-    this->spins        = std::vector<Spin> {};
-    this->constant     = 0.0;
-    this->length       = 0;
-}
-
-Graph::Graph (const Graph& g) {
-    this->adj_list     = g.adj_list;
-    this->adj_map      = g.adj_map;
-    this->constant_map = g.constant_map;
-    this->spins        = g.spins;
-    this->constant     = g.constant;
-    this->length       = g.length;
+    this->terms  = std::make_shared<Hamiltonian>();
+    this->spins  = std::vector<Spin> {};
+    this->length = 0;
 }
 
 /* Manipulator */
 
 // Push back an edge
 void Graph::pushBack (const int& po1, const int& po2, const double& co) {
-    AdjNode *node1 = new AdjNode(po2, co);
-    privatePushBack(po1, node1);
+    Hamiltonian& h = this->mutableTerms();
+    privatePushBack(po1, h.newNode(po2, co));
     if (po1 == po2) return; // self loop
-    AdjNode *node2 = new AdjNode(po1, co);
-    privatePushBack(po2, node2);
+    privatePushBack(po2, h.newNode(po1, co));
     return;
 };
 
@@ -207,21 +238,22 @@ void Graph::pushBack (const int& po, const double& co) {
 }
 
 void Graph::pushBack (const double& co) {
-    this->constant += co;
+    this->mutableTerms().constant += co;
     return;
 }
 
 void Graph::growLayer (const int& grow_count, const double& gamma) {
+    Hamiltonian& h            = this->mutableTerms(); // Unshared, the pushes change it in place
     const int length          = this->getLength();
     const int height          = this->spins.size() / length;
-    const int origin_constant = this->constant / height;
+    const int origin_constant = h.constant / height;
     const double g            = (-0.5) * loge(tanh(gamma));
     for (int i = 0; i < grow_count; ++i) {
         // Duplicate the current layer to the new layer
         for (int j = 0; j < length; ++j) {
             const int index = (i + 1) * length + j; // New layer's index
             // Add edge between the new layer
-            AdjNode *tmp    = adj_list[j];
+            AdjNode *tmp    = h.adj_list[j];
             while (tmp != nullptr) {
                 const int corr_node = tmp->val + (length * (i + 1));
                 // Prevent from adding edge to the next layer
@@ -234,12 +266,12 @@ void Graph::growLayer (const int& grow_count, const double& gamma) {
                 tmp = tmp->next;
             }
             // Add constant map of the new layer
-            if (constant_map.find(j) != constant_map.end()) {
-                this->pushBack(index, constant_map[j]);
+            if (h.constant_map.find(j) != h.constant_map.end()) {
+                this->pushBack(index, h.constant_map[j]);
             }
         }
         // Add constant of the new layer
-        this->constant += origin_constant;
+        h.constant += origin_constant;
         // Add edge between the new layer & the previous layer
         for (int j = 0; j < length; ++j) {
             const int index          = i * length + j; // Previous layer's index
@@ -259,6 +291,140 @@ void Graph::growLayer (const int& grow_count, const double& gamma) {
     return;
 }
 
+// Steepest descent of config restricted to the spins in [begin, end) and the edges between them:
+// flip the most negative delta E until none is left. The delta E of every spin is cached and
+// patched along the edges of each flip, a heap orders them with stale entries skipped on pop, so
+// a flip costs O(degree log N) instead of a sweep.
+int Graph::descend (std::vector<Spin>& config, const int& begin, const int& end) const {
+    typedef std::pair<double, int> Entry; // (delta E, index)
+    const std::vector<AdjNode *>& adj_list = terms->adj_list;
+    std::vector<double> delta(end - begin, 0.0);
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > heap;
+    for (int i = begin; i < end; ++i) {
+        double field  = 0.0;
+        AdjNode *head = i < (int)adj_list.size() ? adj_list[i] : nullptr; // Linear term only
+        for (AdjNode *tmp = head; tmp != nullptr; tmp = tmp->next)
+            if (tmp->val >= begin && tmp->val < end && tmp->val != i)
+                field += tmp->weight * (double)config[tmp->val];
+        std::map<int, double>::const_iterator it = terms->constant_map.find(i);
+        if (it != terms->constant_map.end()) field += it->second;
+        delta[i - begin] = -2.0 * (double)config[i] * field;
+        if (delta[i - begin] < 0.0) heap.push({ delta[i - begin], i });
+    }
+
+    // Patched deltas drift, a flip must lower the energy by more than the rounding noise
+    const double noise = DESCENT_ROUNDOFF * (heap.empty() ? 0.0 : -heap.top().first);
+    int flips          = 0;
+    while (!heap.empty()) {
+        const Entry top = heap.top();
+        heap.pop();
+        if (top.first != delta[top.second - begin]) continue; // Stale
+        if (top.first >= -noise) break;
+
+        const int i          = top.second;
+        const double old_s_i = (double)config[i];
+        config[i]            = (config[i] == UP) ? DOWN : UP;
+        delta[i - begin]     = -top.first;
+        ++flips;
+        // delta E_j = -2 s_j (w s_i + ...), the w s_i term changed sign
+        AdjNode *head = i < (int)adj_list.size() ? adj_list[i] : nullptr;
+        for (AdjNode *tmp = head; tmp != nullptr; tmp = tmp->next) {
+            const int j = tmp->val;
+            if (j < begin || j >= end || j == i) continue;
+            double& d = delta[j - begin];
+            d += 4.0 * tmp->weight * (double)config[j] * old_s_i;
+            if (d < 0.0) heap.push({ d, j });
+        }
+    }
+    return flips;
+}
+
+// Breadth first order of every component from a pseudo-peripheral spin (the far end of repeated
+// searches from a spin of lowest degree). With by_degree the neighbours of a spin are taken in
+// increasing degree (Cuthill-McKee), otherwise in adjacency order. Neighbours then get nearby
+// indices, reversing the order gives RCM.
+std::vector<int> Graph::getOrdering (const bool& by_degree) const {
+    const int n = spins.size();
+    std::vector<std::vector<int> > neighbours(n);
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i)
+        for (AdjNode *tmp = terms->adj_list[i]; tmp != nullptr; tmp = tmp->next)
+            if (tmp->val != i) neighbours[i].push_back(tmp->val);
+    for (std::vector<int>& list : neighbours) {
+        std::sort(list.begin(), list.end()); // Parallel edges count once
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+    if (by_degree)
+        for (std::vector<int>& list : neighbours)
+            std::stable_sort(list.begin(), list.end(), [&] (const int& a, const int& b) {
+                return neighbours[a].size() < neighbours[b].size();
+            });
+
+    // Breadth first search from root over the unplaced spins, level holds the depths of visit
+    std::vector<int> order, visit, level(n, -1);
+    std::vector<bool> placed(n, false);
+    auto search = [&] (const int& root) {
+        for (const int& i : visit)
+            level[i] = -1;
+        visit       = { root };
+        level[root] = 0;
+        for (int k = 0; k < (int)visit.size(); ++k)
+            for (const int& j : neighbours[visit[k]])
+                if (!placed[j] && level[j] < 0) {
+                    level[j] = level[visit[k]] + 1;
+                    visit.push_back(j);
+                }
+    };
+    auto lower = [&] (const int& a, const int& b) {
+        return neighbours[a].size() < neighbours[b].size();
+    };
+
+    for (int s = 0; s < n; ++s) {
+        if (placed[s]) continue;
+        search(s);
+        int root = *std::min_element(visit.begin(), visit.end(), lower);
+        // Move the root to the deepest level until the depth stops growing
+        for (int depth = -1;;) {
+            search(root);
+            const int far_depth = level[visit.back()];
+            if (far_depth <= depth) break;
+            depth = far_depth;
+            root  = visit.back();
+            for (const int& i : visit)
+                if (level[i] == far_depth && lower(i, root)) root = i;
+        }
+        for (const int& i : visit) {
+            placed[i] = true;
+            order.push_back(i);
+        }
+    }
+    return order;
+}
+
+// The graph with spin k taken from spin order[k] of this one
+Graph Graph::permute (const std::vector<int>& order) const {
+    const int n = spins.size();
+    std::vector<int> position(n);
+    for (int k = 0; k < n; ++k)
+        position[order[k]] = k;
+
+    // Edges are pushed in the new order, so the nodes of neighbouring spins are allocated together
+    Graph g;
+    for (int k = 0; k < n; ++k) {
+        const int i   = order[k];
+        AdjNode *head = i < (int)terms->adj_list.size() ? terms->adj_list[i] : nullptr;
+        for (AdjNode *tmp = head; tmp != nullptr; tmp = tmp->next)
+            if (position[tmp->val] >= k) g.pushBack(k, position[tmp->val], tmp->weight);
+    }
+    for (auto const& it : terms->constant_map)
+        g.pushBack(position[it.first], it.second);
+    g.pushBack(terms->constant);
+    g.spins.resize(n, UP);
+    for (int k = 0; k < n; ++k)
+        g.spins[k] = spins[order[k]];
+    g.length = this->length;
+    return g;
+}
+
 // Flip the spin of the given index
 void Graph::flipSpin (const int& index) {
     spins[index] = (spins[index] == UP) ? DOWN : UP;
@@ -276,12 +442,13 @@ void Graph::setSpin (const int index, const int value) {
 
 // Update the gamma of the graph
 void Graph::updateGamma (const double& gamma) {
+    Hamiltonian& h         = this->mutableTerms(); // Other copies keep their gamma
     char gamma_update_flag = 0X00; // check if gamma is updated for both up and down
     const int length       = this->getLength();
     const int height       = this->spins.size() / length;
     // std::cout << "length = " << length << " height = " << height << std::endl;
-    for (int i = 0; i < adj_list.size(); ++i) {
-        AdjNode *tmp             = adj_list[i];
+    for (int i = 0; i < (int)h.adj_list.size(); ++i) {
+        AdjNode *tmp             = h.adj_list[i];
         // const int next_layer_idx = get_layer_up(i, length, height);
         // const int prev_layer_idx = get_layer_down(i, length, height);
         const int next_layer_idx = (i + length) % (length * height);
@@ -315,8 +482,8 @@ void Graph::lockLength (const int& ll) {
 
 void Graph::print (std::ofstream& cout) {
     cout << "Adjacency List:" << std::endl;
-    for (int i = 0; i < adj_list.size(); i++) {
-        AdjNode *tmp = adj_list[i];
+    for (int i = 0; i < (int)terms->adj_list.size(); i++) {
+        AdjNode *tmp = terms->adj_list[i];
         cout << i << ": ";
         while (tmp != nullptr) {
             cout << tmp->val << " " << tmp->weight << " | ";
@@ -326,7 +493,8 @@ void Graph::print (std::ofstream& cout) {
     }
 
     cout << std::endl << "Adjacency Map:" << std::endl;
-    for (std::map<int, std::vector<int> >::iterator it = adj_map.begin(); it != adj_map.end();
+    const std::map<int, std::vector<int> > adj_map = this->getAdjMap();
+    for (std::map<int, std::vector<int> >::const_iterator it = adj_map.begin(); it != adj_map.end();
          it++) {
         cout << it->first << ": ";
         for (int i = 0; i < it->second.size(); i++) {
@@ -336,12 +504,12 @@ void Graph::print (std::ofstream& cout) {
     }
 
     cout << std::endl << "Constant Map: " << std::endl;
-    for (std::map<int, double>::iterator it = constant_map.begin(); it != constant_map.end();
-         it++) {
+    for (std::map<int, double>::const_iterator it = terms->constant_map.begin();
+         it != terms->constant_map.end(); it++) {
         cout << it->first << ": " << it->second << std::endl;
     }
 
-    cout << std::endl << "Constant: " << constant << std::endl;
+    cout << std::endl << "Constant: " << terms->constant << std::endl;
 
     cout << std::endl << "Spins:" << std::endl;
     for (int i = 0; i < spins.size(); i++) {
@@ -366,9 +534,9 @@ void Graph::printConfig (std::ofstream& cout) const {
 
     double sum = 0.0;
     // std::cout << "init sum = " << sum << std::endl;
-    for (int i = 0; i < this->adj_list.size(); ++i) {
+    for (int i = 0; i < (int)terms->adj_list.size(); ++i) {
         break;
-        AdjNode *tmp = this->adj_list[i];
+        AdjNode *tmp = terms->adj_list[i];
         if (tmp == nullptr) continue;
         const double spin = (double)spins[i]; // Get spin of current node
 
@@ -4,6 +4,8 @@
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <vector>
 
 #include "../include/Spin.h"
@@ -15,27 +17,40 @@ struct AdjNode {
     AdjNode (int v, double w) : val(v), weight(w), next(nullptr) {}
 };
 
+// Couplings, fields and constant of a graph. The copies of a graph share them, a copy that
+// changes them clones them first (copy on write), so copying a graph costs its spins only.
+// The nodes live in an arena of growing blocks, freed all at once with the terms.
+struct Hamiltonian {
+    std::pmr::monotonic_buffer_resource arena; // Storage of every AdjNode of adj_list
+    std::vector<AdjNode *> adj_list;           // vector of pointers to AdjNode (sorted by index)
+    std::map<int, double> constant_map;        // index of node -> constant
+    double constant = 0.0;
+
+    Hamiltonian();
+    Hamiltonian(const Hamiltonian&); // Deep copy of the nodes, into a single block
+    Hamiltonian& operator=(const Hamiltonian&) = delete;
+
+    AdjNode *newNode(const int&, const double&); // (neighbor, weight), owned by the arena
+};
+
 class Graph {
     friend class Annealer;
     friend void testSpin(int, Graph);
 
   protected:
-    std::vector<AdjNode *> adj_list;          // vector of pointers to AdjNode (sorted by index)
-    std::map<int, std::vector<int> > adj_map; // index of node -> vector of neighbors
-    std::map<int, double> constant_map;       // index of node -> constant
+    std::shared_ptr<const Hamiltonian> terms; // Shared with the copies of the graph
     std::vector<Spin> spins;                  // vector of spins (sorted by index)
-    double constant;
     int length; // Length of the graph
 
+    Hamiltonian& mutableTerms(); // The terms of this graph alone, cloned first if shared
     void privatePushBack(const int&, AdjNode *);
     void privatePushBack(const int&, const double&);
 
   public:
     /* Constructor */
-    Graph();
-    Graph(const Graph&); // Copy constructor
+    Graph(); // Copies and moves are implicit, a copy shares the terms
 
-    std::map<int, std::vector<int> > getAdjMap() const;
+    std::map<int, std::vector<int> > getAdjMap() const; // index of node -> vector of neighbors
 
     /* Manipulator */
     void pushBack(const double&);                         // Push back a constant
@@ -47,6 +62,11 @@ class Graph {
     void lockLength();           // Lock the length of the graph to current spins.size()
     void lockLength(const int&); // Lock the length of the graph to current spins.size()
     void growLayer(const int&, const double&); // Grow the graph by a layer
+    int descend(std::vector<Spin>&, const int&,
+                const int&) const; // Steepest descent of config over [begin, end), returns flips
+    std::vector<int> getOrdering(
+        const bool&) const; // Breadth first order (new -> old index), Cuthill-McKee with true
+    Graph permute(const std::vector<int>&) const; // The graph relabeled by an order (new -> old)
 
     /* Accessors */
     std::vector<Spin> getSpins() const; // Get the spin config vector of the graph
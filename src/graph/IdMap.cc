@@ -0,0 +1,40 @@
+#include "IdMap.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// IdMap Constructor
+IdMap::IdMap () : identity(true) {
+    return;
+}
+IdMap::IdMap (std::vector<int64_t> seen) : ids(std::move(seen)) {
+    std::sort(this->ids.begin(), this->ids.end());
+    this->ids.erase(std::unique(this->ids.begin(), this->ids.end()), this->ids.end());
+    if (this->ids.size() > INT32_MAX) throw std::invalid_argument("Too many spins in the input");
+    this->identity = this->ids.empty() || (this->ids.front() == 0 &&
+                                           this->ids.back() == (int64_t)this->ids.size() - 1);
+    if (this->identity) return;
+    this->index_of.reserve(this->ids.size());
+    for (int i = 0; i < (int)this->ids.size(); ++i)
+        this->index_of.emplace(this->ids[i], i);
+    return;
+}
+
+// IdMap Accessors
+int IdMap::size () const {
+    return this->ids.size();
+}
+
+int IdMap::index (const int64_t& id) const {
+    if (this->identity) return (0 <= id && id < (int64_t)this->ids.size()) ? (int)id : -1;
+    std::unordered_map<int64_t, int>::const_iterator it = this->index_of.find(id);
+    return it == this->index_of.end() ? -1 : it->second;
+}
+
+int64_t IdMap::id (const int& index) const {
+    return this->ids[index];
+}
+
+std::vector<int64_t> IdMap::getIds () const {
+    return this->ids;
+}
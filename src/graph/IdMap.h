@@ -0,0 +1,31 @@
+#ifndef _ID_MAP_H_
+#define _ID_MAP_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Spin IDs of an input file (any 64-bit integers) and the dense indices 0..N-1 of the graph.
+ * Indices follow the increasing order of the IDs, so an input numbered 0..N-1 keeps its indices
+ * and needs no hash table.
+ */
+class IdMap {
+  private:
+    std::vector<int64_t> ids;                  // Sorted, ids[index] is the ID of a spin
+    std::unordered_map<int64_t, int> index_of; // Empty when ids[i] == i
+    bool identity;
+
+  public:
+    /* Constructor */
+    IdMap();
+    IdMap(std::vector<int64_t>); // The IDs seen, in any order and with repeats
+
+    /* Accessors */
+    int size() const;
+    int index(const int64_t&) const; // Dense index of an ID, -1 when it is not a spin
+    int64_t id(const int&) const;    // ID of a dense index
+    std::vector<int64_t> getIds() const;
+};
+
+#endif
@@ -0,0 +1,294 @@
+#include "preprocess.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace preprocess {
+
+// Couplings between the free spins, the fields absorb the fixed ones
+struct Problem {
+    std::vector<std::vector<std::pair<int, double> > > edges; // Both directions, no self loops
+    std::vector<double> field;
+    std::vector<Spin> spins;
+    std::vector<bool> fixed;
+    double offset = 0.0;
+};
+
+// Read access to the adjacency of a graph
+class Source : public Graph {
+  public:
+    Source (const Graph& g) : Graph(g) {}
+
+    Problem load () const {
+        Problem p;
+        const int n = this->spins.size();
+        p.edges.resize(n);
+        p.field.assign(n, 0.0);
+        p.spins = this->spins;
+        p.fixed.assign(n, false);
+        p.offset = this->terms->constant;
+        for (int i = 0; i < (int)terms->adj_list.size(); ++i)
+            for (AdjNode *tmp = terms->adj_list[i]; tmp != nullptr; tmp = tmp->next) {
+                if (tmp->val == i) p.offset += tmp->weight; // s_i s_i = 1
+                else p.edges[i].emplace_back(tmp->val, tmp->weight);
+            }
+        for (auto const& it : terms->constant_map)
+            p.field[it.first] += it.second;
+        return p;
+    }
+};
+
+static void fix (Problem& p, const int& i, const Spin& s) {
+    p.fixed[i] = true;
+    p.spins[i] = s;
+    p.offset += p.field[i] * (double)s;
+    for (const std::pair<int, double>& e : p.edges[i])
+        if (!p.fixed[e.first]) p.field[e.first] += e.second * (double)s;
+    return;
+}
+
+// Fix every spin whose field outweighs its couplings, returns the spins fixed
+static int fixDominated (Problem& p) {
+    const int n = p.spins.size();
+    std::vector<int> stack;
+    std::vector<bool> queued(n, false);
+    for (int i = n - 1; i >= 0; --i)
+        if (!p.fixed[i]) {
+            stack.push_back(i);
+            queued[i] = true;
+        }
+    int count = 0;
+    while (!stack.empty()) {
+        const int i = stack.back();
+        stack.pop_back();
+        queued[i] = false;
+        if (p.fixed[i]) continue;
+        double coupling = 0.0;
+        for (const std::pair<int, double>& e : p.edges[i])
+            if (!p.fixed[e.first]) coupling += std::fabs(e.second);
+        if (std::fabs(p.field[i]) < coupling) continue;
+        // A spin without field or couplings keeps its value
+        fix(p, i, p.field[i] > 0.0 ? DOWN : (p.field[i] < 0.0 ? UP : p.spins[i]));
+        ++count;
+        for (const std::pair<int, double>& e : p.edges[i])
+            if (!p.fixed[e.first] && !queued[e.first]) {
+                stack.push_back(e.first);
+                queued[e.first] = true;
+            }
+    }
+    return count;
+}
+
+// Max flow network (Dinic)
+class Network {
+  private:
+    struct Arc {
+        int to, rev;
+        double cap;
+    };
+    std::vector<std::vector<Arc> > arcs;
+    std::vector<int> level, next;
+    double eps = 0.0;
+
+    bool layer (const int& source, const int& sink) {
+        level.assign(arcs.size(), -1);
+        std::queue<int> queue;
+        level[source] = 0;
+        queue.push(source);
+        while (!queue.empty()) {
+            const int u = queue.front();
+            queue.pop();
+            for (const Arc& a : arcs[u])
+                if (a.cap > eps && level[a.to] < 0) {
+                    level[a.to] = level[u] + 1;
+                    queue.push(a.to);
+                }
+        }
+        return level[sink] >= 0;
+    }
+
+  public:
+    Network (const int& nodes) : arcs(nodes) {}
+
+    void addArc (const int& u, const int& v, const double& cap) {
+        arcs[u].push_back({ v, (int)arcs[v].size(), cap });
+        arcs[v].push_back({ u, (int)arcs[u].size() - 1, 0.0 });
+        eps = std::max(eps, cap * 1e-12);
+        return;
+    }
+
+    // Augment along blocking flows of the level graph, the paths are walked without recursion
+    void maxFlow (const int& source, const int& sink) {
+        while (this->layer(source, sink)) {
+            next.assign(arcs.size(), 0);
+            std::vector<int> path; // Arc index taken out of each node of the walk
+            std::vector<int> nodes = { source };
+            while (!nodes.empty()) {
+                const int u = nodes.back();
+                if (u == sink) {
+                    double push = arcs[nodes[0]][path[0]].cap;
+                    for (int k = 0; k < (int)path.size(); ++k)
+                        push = std::min(push, arcs[nodes[k]][path[k]].cap);
+                    for (int k = 0; k < (int)path.size(); ++k) {
+                        Arc& a = arcs[nodes[k]][path[k]];
+                        a.cap -= push;
+                        arcs[a.to][a.rev].cap += push;
+                    }
+                    path.clear();
+                    nodes = { source };
+                    continue;
+                }
+                for (; next[u] < (int)arcs[u].size(); ++next[u]) {
+                    const Arc& a = arcs[u][next[u]];
+                    if (a.cap > eps && level[a.to] == level[u] + 1) break;
+                }
+                if (next[u] < (int)arcs[u].size()) {
+                    path.push_back(next[u]);
+                    nodes.push_back(arcs[u][next[u]].to);
+                } else {
+                    level[u] = -1; // Dead end
+                    nodes.pop_back();
+                    if (!path.empty()) {
+                        ++next[nodes.back()];
+                        path.pop_back();
+                    }
+                }
+            }
+        }
+        return;
+    }
+
+    // Nodes reachable from source over arcs with residual capacity
+    std::vector<bool> reachable (const int& source) const {
+        std::vector<bool> seen(arcs.size(), false);
+        std::vector<int> stack = { source };
+        seen[source]           = true;
+        while (!stack.empty()) {
+            const int u = stack.back();
+            stack.pop_back();
+            for (const Arc& a : arcs[u])
+                if (a.cap > eps && !seen[a.to]) {
+                    seen[a.to] = true;
+                    stack.push_back(a.to);
+                }
+        }
+        return seen;
+    }
+};
+
+// Fix the strong persistencies of roof duality, returns the spins fixed. With s = 2x - 1 the
+// free spins are a QUBO, written as a posiform (positive terms of literals x or not x). A term
+// c u v adds the arcs u -> not v and v -> not u of capacity c / 2, a term c u the arcs
+// source -> not u and u -> sink. Literal k is node 2k, its complement 2k + 1, the source is the
+// literal true and the sink its complement. A literal reachable from the source in the residual
+// network of a max flow is true in every minimizer.
+static int fixPersistent (Problem& p) {
+    const int n = p.spins.size();
+    std::vector<int> free, local(n, -1);
+    for (int i = 0; i < n; ++i)
+        if (!p.fixed[i]) {
+            local[i] = free.size();
+            free.push_back(i);
+        }
+    const int m = free.size();
+    if (m == 0) return 0;
+    const int source = 2 * m, sink = 2 * m + 1;
+    Network network(2 * m + 2);
+    auto quadratic = [&] (const double& c, const int& u, const int& v) {
+        network.addArc(u, v ^ 1, c / 2);
+        network.addArc(v, u ^ 1, c / 2);
+    };
+
+    std::vector<double> linear(m);
+    for (int k = 0; k < m; ++k)
+        linear[k] = 2.0 * p.field[free[k]];
+    for (int k = 0; k < m; ++k)
+        for (const std::pair<int, double>& e : p.edges[free[k]]) {
+            const int l = local[e.first];
+            if (l <= k) continue; // Fixed, or the other direction of the edge
+            // w s s = 4w x x - 2w x - 2w x + w
+            const double b = 4.0 * e.second;
+            linear[k] -= 2.0 * e.second;
+            linear[l] -= 2.0 * e.second;
+            if (b > 0.0) {
+                quadratic(b, 2 * k, 2 * l);
+            } else if (b < 0.0) {
+                linear[k] += b; // b x_k x_l = b x_k + |b| x_k (not x_l)
+                quadratic(-b, 2 * k, 2 * l + 1);
+            }
+        }
+    for (int k = 0; k < m; ++k) {
+        if (linear[k] == 0.0) continue;
+        const int u = linear[k] > 0.0 ? 2 * k : 2 * k + 1;
+        network.addArc(source, u ^ 1, std::fabs(linear[k]) / 2);
+        network.addArc(u, sink, std::fabs(linear[k]) / 2);
+    }
+
+    network.maxFlow(source, sink);
+    const std::vector<bool> reach = network.reachable(source);
+    int count = 0;
+    for (int k = 0; k < m; ++k) {
+        if (reach[2 * k] == reach[2 * k + 1]) continue;
+        fix(p, free[k], reach[2 * k] ? UP : DOWN);
+        ++count;
+    }
+    return count;
+}
+
+Reduction reduce (const Graph& graph) {
+    Problem p = Source(graph).load();
+    Reduction r;
+    // A fixed spin can make its neighbours dominated, whose fields can free new persistencies
+    while (true) {
+        r.dominance += fixDominated(p);
+        const int persistent = fixPersistent(p);
+        r.persistency += persistent;
+        if (persistent == 0) break;
+    }
+
+    const int n = p.spins.size();
+    std::vector<int> local(n, -1);
+    for (int i = 0; i < n; ++i) {
+        if (p.fixed[i] || local[i] >= 0) continue;
+        std::vector<int> component = { i };
+        local[i]                   = 0;
+        for (int k = 0; k < (int)component.size(); ++k)
+            for (const std::pair<int, double>& e : p.edges[component[k]])
+                if (!p.fixed[e.first] && local[e.first] < 0) {
+                    local[e.first] = 0;
+                    component.push_back(e.first);
+                }
+        std::sort(component.begin(), component.end());
+        for (int k = 0; k < (int)component.size(); ++k)
+            local[component[k]] = k;
+
+        Graph g;
+        for (int k = 0; k < (int)component.size(); ++k) {
+            const int j = component[k];
+            for (const std::pair<int, double>& e : p.edges[j])
+                if (!p.fixed[e.first] && local[e.first] > k)
+                    g.pushBack(k, local[e.first], e.second);
+            if (p.field[j] != 0.0) g.pushBack(k, p.field[j]);
+        }
+        for (int k = 0; k < (int)component.size(); ++k)
+            g.setSpin(k, p.spins[component[k]]);
+        g.lockLength();
+        r.components.push_back(component);
+        r.graphs.push_back(g);
+    }
+    r.spins  = p.spins;
+    r.fixed  = p.fixed;
+    r.offset = p.offset;
+    return r;
+}
+
+std::vector<Spin> expand (const Reduction& r, const std::vector<std::vector<Spin> >& configs) {
+    std::vector<Spin> spins = r.spins;
+    for (int c = 0; c < (int)r.components.size(); ++c)
+        for (int k = 0; k < (int)r.components[c].size(); ++k)
+            spins[r.components[c][k]] = configs[c][k];
+    return spins;
+}
+
+} // namespace preprocess
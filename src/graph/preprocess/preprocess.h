@@ -0,0 +1,36 @@
+#ifndef _PREPROCESS_H_
+#define _PREPROCESS_H_
+
+#include "../Graph.h"
+
+#include <vector>
+
+/*
+ * Ground state preserving reductions of an Ising graph, E = sum w s s + sum h s + c.
+ *
+ * Spins are fixed by dominance (a field at least as strong as all the couplings of the spin,
+ * |h_i| >= sum |w_ij|) and by roof duality (the strong persistencies of the max flow over the
+ * implication network of the QUBO posiform). Every fixed spin turns its couplings into fields
+ * of its neighbours, so fixing repeats until nothing changes. The free spins then split into
+ * connected components, each its own graph. Fixing keeps every ground state (dominance keeps at
+ * least one), but it changes the finite temperature distribution.
+ */
+namespace preprocess {
+
+struct Reduction {
+    std::vector<Spin> spins;                   // Fixed spins, free spins keep their input value
+    std::vector<bool> fixed;                   // Per original index
+    std::vector<std::vector<int> > components; // Original index of every spin of each component
+    std::vector<Graph> graphs;                 // Spin k of graphs[c] is components[c][k]
+    double offset   = 0.0;                     // Energy of the fixed spins and the constant
+    int dominance   = 0;                       // Spins fixed by dominance
+    int persistency = 0;                       // Spins fixed by roof duality
+};
+
+Reduction reduce(const Graph&); // Fix what can be fixed, split the rest into components
+std::vector<Spin> expand(const Reduction&,
+                         const std::vector<std::vector<Spin> >&); // Configuration of every graph
+
+} // namespace preprocess
+
+#endif
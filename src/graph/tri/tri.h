@@ -3,13 +3,18 @@
 
 #include "../Graph.h"
 
+#include <functional>
 #include <vector>
 
 namespace tri {
 
+typedef std::function<void(const int&, const int&, const double&)> EdgeSink; // po1, po2, co
+
 std::vector<double> getSquaredOP(const std::vector<Spin>&,
                                  const int); // getSquaredOP(graph.spins, graph.length)
 Graph makeGraph(const int&);                 // makeGraph(length)
+void pushEdges(const int&, const int&, const int&,
+               const EdgeSink&); // pushEdges(length, row_begin, row_end, sink)
 void printTriConf(const std::vector<Spin>&, const int&,
                   std::ofstream&); // printTriConf(graph.spins, length, output_stream)
 
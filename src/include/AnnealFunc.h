@@ -1 +1,6 @@
-enum ANNEAL_FUNC { SA, SQA, NIL };
+#ifndef _ANNEALFUNC_H_
+#define _ANNEALFUNC_H_
+
+enum ANNEAL_FUNC { SA, SQA, TABU, PA, WL, NIL };
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Run func(begin, end) over [0, count) in contiguous chunks, one per thread
+inline void parallelFor (const int& threads, const int& count,
+                         const std::function<void(int, int)>& func) {
+    if (threads <= 1 || count <= 1) return func(0, count);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back(func, (long)count * t / threads, (long)count * (t + 1) / threads);
+    for (std::thread& worker : workers)
+        worker.join();
+    return;
+}
+
+#endif
@@ -1 +1,6 @@
+#ifndef _SPIN_H_
+#define _SPIN_H_
+
 enum Spin { UP = 1, DOWN = -1 };
+
+#endif
@@ -0,0 +1,277 @@
+#include "jobs.h"
+#include "../api/anneal.h"
+#include "../api/internal.h"
+#include "../graph/IdMap.h"
+#include "../graph/tri/tri.h"
+#include "../run.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace jobs {
+
+namespace {
+
+using SolverHandle = std::unique_ptr<anneal_solver, decltype(&anneal_solver_destroy)>;
+using GraphHandle  = std::unique_ptr<anneal_graph, decltype(&anneal_graph_destroy)>;
+using Option       = std::pair<std::string, std::string>; // key, value
+
+const char *ENGINE_NAMES[] = { "sa", "sqa", "tabu", "pa" }; // By ANNEAL_SA ... ANNEAL_PA
+
+struct Instance {
+    std::string name;
+    GraphHandle graph;
+};
+
+struct Grid {
+    int line; // Of the first line of the block
+    std::vector<int> instances;
+    std::vector<int> engines;
+    std::vector<std::pair<std::string, std::vector<std::string> > > axes; // Option, values
+};
+
+struct Job {
+    int instance;
+    int engine;
+    std::vector<Option> options;
+    SolverHandle solver;
+};
+
+struct Row {
+    int replicas = 0;
+    double best = 0.0, mean = 0.0, seconds = 0.0;
+    std::string status;
+};
+
+// Whether an engine takes an option, a grid over one it ignores would only repeat its jobs
+bool takes (const int& engine, const std::string& key) {
+    if (key == "layers" || key == "gamma" || key == "worldline") return engine == ANNEAL_SQA;
+    if (key == "tenure" || key == "starts") return engine == ANNEAL_TABU;
+    if (key == "population") return engine == ANNEAL_PA;
+    if (key == "cluster") return engine == ANNEAL_SA;
+    if (key == "init" || key == "final" || key == "schedule" || key == "sweeps_per_step")
+        return engine != ANNEAL_TABU;
+    if (key == "threads") return engine != ANNEAL_SQA;
+    return true;
+}
+
+int engineOf (const std::string& name) {
+    for (int e = ANNEAL_SA; e <= ANNEAL_PA; ++e)
+        if (name == ENGINE_NAMES[e]) return e;
+    throw std::invalid_argument("Unknown engine " + name + ", expected sa, sqa, tabu or pa");
+}
+
+// Load an instance line once, by its file (and mode) or lattice width
+int loadInstance (std::istringstream& words, std::vector<Instance>& instances,
+                  std::map<std::string, int>& loaded) {
+    std::string source, mode;
+    if (!(words >> source)) throw std::invalid_argument("instance <file> [qubo] or tri <width>");
+    words >> mode;
+    const std::string name = source == "tri" ? "tri:" + mode
+                             : mode.empty()  ? source
+                                             : source + ":" + mode;
+    std::map<std::string, int>::const_iterator it = loaded.find(name);
+    if (it != loaded.end()) return it->second;
+
+    Graph graph;
+    if (source == "tri") {
+        const int width = std::atoi(mode.c_str());
+        if (width < 1) throw std::invalid_argument("instance tri needs a width: " + mode);
+        graph = tri::makeGraph(width);
+    } else {
+        if (!mode.empty() && mode != "qubo")
+            throw std::invalid_argument("Unknown instance mode " + mode);
+        std::fstream file(source, std::ios::in);
+        if (!file.is_open()) throw std::invalid_argument("Cannot open " + source);
+        IdMap ids;
+        graph = mode == "qubo" ? readInputFromQubo(file, ids) : readInput(file, ids);
+    }
+    graph.lockLength();
+    GraphHandle handle(annealGraph(graph), &anneal_graph_destroy); // Shares the terms
+    if (!handle) throw std::invalid_argument(anneal_last_error());
+    instances.push_back(Instance { name, std::move(handle) });
+    loaded.emplace(name, instances.size() - 1);
+    return instances.size() - 1;
+}
+
+std::vector<Grid> readGrids (std::fstream& source, std::vector<Instance>& instances) {
+    std::vector<Grid> grids;
+    std::map<std::string, int> loaded;
+    std::optional<Grid> grid;
+    std::string line;
+    for (int number = 1; std::getline(source, line); ++number) {
+        std::istringstream words(line);
+        std::string key;
+        if (!(words >> key)) { // A blank line ends the grid
+            if (grid) grids.push_back(std::move(*grid));
+            grid.reset();
+            continue;
+        }
+        if (key[0] == '#') continue;
+        if (!grid) grid = Grid { number };
+        try {
+            if (key == "instance") {
+                grid->instances.push_back(loadInstance(words, instances, loaded));
+                continue;
+            }
+            std::vector<std::string> values;
+            for (std::string value; words >> value;)
+                values.push_back(value);
+            if (values.empty()) throw std::invalid_argument(key + " has no values");
+            if (key == "func") {
+                for (const std::string& name : values)
+                    grid->engines.push_back(engineOf(name));
+                continue;
+            }
+            if (key == "height") key = "layers";
+            std::vector<std::pair<std::string, std::vector<std::string> > >::iterator axis =
+                std::find_if(grid->axes.begin(), grid->axes.end(),
+                             [&] (const auto& a) { return a.first == key; });
+            if (axis == grid->axes.end()) grid->axes.emplace_back(key, values);
+            else axis->second.insert(axis->second.end(), values.begin(), values.end());
+        } catch (const std::exception& e) {
+            throw std::invalid_argument("--jobs line " + std::to_string(number) + ": " + e.what());
+        }
+    }
+    if (grid) grids.push_back(std::move(*grid));
+    return grids;
+}
+
+// Every job of the grids, with its solver set up so a bad value fails before any job runs
+std::vector<Job> expand (const std::vector<Grid>& grids) {
+    std::vector<Job> jobs;
+    for (const Grid& grid : grids) {
+        if (grid.instances.empty())
+            throw std::invalid_argument("--jobs grid at line " + std::to_string(grid.line) +
+                                        ": a grid needs an instance");
+        const std::vector<int> engines =
+            grid.engines.empty() ? std::vector<int> { ANNEAL_SA } : grid.engines;
+        for (const int& instance : grid.instances)
+            for (const int& engine : engines) {
+                std::vector<const std::pair<std::string, std::vector<std::string> > *> axes;
+                for (const auto& axis : grid.axes)
+                    if (takes(engine, axis.first)) axes.push_back(&axis);
+                // Odometer over the values of the axes, the last one turns fastest
+                std::vector<int> at(axes.size(), 0);
+                for (bool more = true; more;) {
+                    Job job { instance, engine, {},
+                              SolverHandle(anneal_solver_create(engine), &anneal_solver_destroy) };
+                    for (int a = 0; a < (int)axes.size(); ++a) {
+                        const Option option(axes[a]->first, axes[a]->second[at[a]]);
+                        if (annealSetOption(job.solver.get(), option.first, option.second) !=
+                            ANNEAL_OK)
+                            throw std::invalid_argument("--jobs grid at line " +
+                                                        std::to_string(grid.line) + ": " +
+                                                        anneal_last_error());
+                        job.options.push_back(option);
+                    }
+                    jobs.push_back(std::move(job));
+                    more = false;
+                    for (int a = axes.size() - 1; a >= 0 && !more; --a) {
+                        more  = ++at[a] < (int)axes[a]->second.size();
+                        at[a] = more ? at[a] : 0;
+                    }
+                }
+            }
+    }
+    return jobs;
+}
+
+Row solve (Job& job, const anneal_graph *graph) {
+    Row row;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int status = anneal_solve(job.solver.get(), graph);
+    row.seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    row.status   = status == ANNEAL_OK ? "ok" : std::string("failed: ") + anneal_last_error();
+    row.replicas = anneal_result_count(job.solver.get());
+    for (int r = 0; r < row.replicas; ++r) {
+        double energy;
+        anneal_result_energy(job.solver.get(), r, &energy);
+        row.best = r == 0 ? energy : row.best;
+        row.mean += energy / row.replicas;
+    }
+    job.solver.reset(); // Frees the results, a scan can have many jobs
+    return row;
+}
+
+} // namespace
+
+int run (const CustomArgs& args) {
+    const std::string filename = std::get<std::string>(args.getArg("--jobs"));
+    std::fstream source(filename, std::ios::in);
+    if (!source.is_open()) throw std::invalid_argument("Cannot open --jobs " + filename);
+    std::vector<Instance> instances;
+    const std::vector<Grid> grids = readGrids(source, instances);
+    std::vector<Job> jobs         = expand(grids);
+
+    // A column for every option of the file, in the order they first appear
+    std::vector<std::string> columns;
+    for (const Grid& grid : grids)
+        for (const auto& axis : grid.axes)
+            if (std::find(columns.begin(), columns.end(), axis.first) == columns.end())
+                columns.push_back(axis.first);
+    std::cout << "job\tinstance\tengine";
+    for (const std::string& column : columns)
+        std::cout << "\t" << column;
+    std::cout << "\tannealed\tbest\tmean\tseconds\tstatus" << std::endl;
+
+    // Rows are written in job order, as soon as the jobs before them are done
+    std::vector<std::optional<Row> > rows(jobs.size());
+    std::mutex lock;
+    int written = 0, failed = 0;
+    auto write = [&] (const int& j, Row row) {
+        std::lock_guard<std::mutex> guard(lock);
+        failed += row.status != "ok";
+        rows[j] = std::move(row);
+        for (; written < (int)jobs.size() && rows[written]; ++written) {
+            const Job& job = jobs[written];
+            const Row& r   = *rows[written];
+            std::ostringstream line;
+            line << std::setprecision(10) << written + 1 << "\t" << instances[job.instance].name
+                 << "\t" << ENGINE_NAMES[job.engine];
+            for (const std::string& column : columns) {
+                std::vector<Option>::const_iterator it =
+                    std::find_if(job.options.begin(), job.options.end(),
+                                 [&] (const Option& o) { return o.first == column; });
+                line << "\t" << (it == job.options.end() ? "-" : it->second);
+            }
+            line << "\t" << r.replicas << "\t" << r.best << "\t" << r.mean << "\t" << std::fixed
+                 << std::setprecision(3) << r.seconds << "\t" << r.status;
+            std::cout << line.str() << std::endl;
+        }
+    };
+
+    const int workers = args.hasArg("--workers")
+                            ? std::get<int>(args.getArg("--workers"))
+                            : std::max(1, (int)std::thread::hardware_concurrency());
+    std::atomic<int> next(0);
+    auto work = [&] () {
+        for (int j = next++; j < (int)jobs.size(); j = next++)
+            write(j, solve(jobs[j], instances[jobs[j].instance].graph.get()));
+    };
+    std::vector<std::thread> pool;
+    for (int w = 1; w < std::min<int>(workers, jobs.size()); ++w)
+        pool.emplace_back(work);
+    work();
+    for (std::thread& t : pool)
+        t.join();
+    return failed > 0 ? 1 : 0;
+}
+
+} // namespace jobs
@@ -0,0 +1,29 @@
+#ifndef _JOBS_H_
+#define _JOBS_H_
+
+#include "../args/Args.h"
+
+/*
+ * Batch mode (--jobs <file>): grids of annealing jobs over instances that are loaded once and
+ * shared by all their jobs, annealed by a pool of --workers threads and reported as one table.
+ * The file is a list of grids, each a block of lines ended by a blank line:
+ *
+ *   instance <file> [qubo]    An instance of the grid, one line each
+ *   instance tri <width>      The --h-tri lattice
+ *   func sa sqa tabu pa       Engines of the grid, sa when not given
+ *   <key> <value> ...         Values of a solver option of src/api/anneal.h, height for layers
+ *
+ * A grid runs every instance with every engine and every combination of the values of the
+ * options the engine takes, so a height list multiplies the sqa jobs alone. Lines starting with
+ * # are comments. The table (tab separated, on stdout) has a row per job in the order of the
+ * file: the job, instance and engine, every option of the file ("-" where the job does not take
+ * it), then annealed (the replicas with a result), their lowest and mean energy, the seconds
+ * and the status.
+ */
+namespace jobs {
+
+int run(const CustomArgs&); // Anneal every job of the file, 1 when a job failed
+
+} // namespace jobs
+
+#endif
@@ -0,0 +1,76 @@
+#include "Profile.h"
+
+#include <algorithm>
+#include <string>
+
+namespace profile {
+
+std::atomic<double> timer_seconds[TIMER_COUNT];
+std::atomic<long> timer_calls[TIMER_COUNT];
+std::atomic<long> counter_values[COUNTER_COUNT];
+
+static const char *TIMER_NAMES[TIMER_COUNT] = { "parse",      "preprocess", "grow_layer",
+                                                "anneal",     "sweep",      "exchange",
+                                                "checkpoint", "cluster",    "polish",
+                                                "output",     "total" };
+static const char *COUNTER_NAMES[COUNTER_COUNT] = { "proposals",     "accepts",
+                                                    "exchanges",     "exchange_accepts",
+                                                    "bytes_sent",    "polish_flips",
+                                                    "cluster_moves", "cluster_accepts",
+                                                    "cluster_spins" };
+
+Report snapshot () {
+    Report r;
+    for (int t = 0; t < TIMER_COUNT; ++t) {
+        r.seconds[t] = timer_seconds[t].load();
+        r.calls[t]   = timer_calls[t].load();
+    }
+    for (int c = 0; c < COUNTER_COUNT; ++c)
+        r.counters[c] = counter_values[c].load();
+    return r;
+}
+
+static void writeReport (std::ostream& out, const Report& r, const std::string& indent) {
+    out << indent << "\"timers\": {";
+    for (int t = 0; t < TIMER_COUNT; ++t) {
+        out << (t ? ", " : "") << "\"" << TIMER_NAMES[t] << "\": { \"seconds\": " << r.seconds[t]
+            << ", \"calls\": " << r.calls[t] << " }";
+    }
+    out << "},\n" << indent << "\"counters\": {";
+    for (int c = 0; c < COUNTER_COUNT; ++c) {
+        out << (c ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << r.counters[c];
+    }
+    out << "}";
+}
+
+void writeJson (std::ostream& out, const std::vector<Report>& ranks) {
+    // Aggregate: counters and calls are summed, time is the slowest rank (the critical path)
+    Report total;
+    for (const Report& r : ranks) {
+        for (int t = 0; t < TIMER_COUNT; ++t) {
+            total.seconds[t] = std::max(total.seconds[t], r.seconds[t]);
+            total.calls[t] += r.calls[t];
+        }
+        for (int c = 0; c < COUNTER_COUNT; ++c)
+            total.counters[c] += r.counters[c];
+    }
+
+    out << "{\n";
+#ifdef NO_PROFILE
+    out << "  \"enabled\": false,\n";
+#else
+    out << "  \"enabled\": true,\n";
+#endif
+    out << "  \"rank_count\": " << ranks.size() << ",\n";
+    out << "  \"total\": {\n";
+    writeReport(out, total, "    ");
+    out << "\n  },\n  \"ranks\": [\n";
+    for (int i = 0; i < (int)ranks.size(); ++i) {
+        out << "    {\n      \"rank\": " << i << ",\n";
+        writeReport(out, ranks[i], "      ");
+        out << "\n    }" << (i + 1 < (int)ranks.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+} // namespace profile
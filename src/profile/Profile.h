@@ -0,0 +1,86 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <vector>
+
+/*
+ * Lightweight run profile: scoped timers and counters, reported as JSON with --profile.
+ * Build with -DNO_PROFILE (make DEFS=-DNO_PROFILE) to compile every probe away.
+ */
+namespace profile {
+
+enum Timer {
+    PARSE,
+    PREPROCESS,
+    GROW_LAYER,
+    ANNEAL,
+    SWEEP,
+    EXCHANGE,
+    CHECKPOINT,
+    CLUSTER,
+    POLISH,
+    OUTPUT,
+    TOTAL,
+    TIMER_COUNT
+};
+enum Counter {
+    PROPOSALS,        // Single spin flip proposals
+    ACCEPTS,          // Accepted single spin flips
+    EXCHANGES,        // Replica exchange / halo exchange attempts
+    EXCHANGE_ACCEPTS, // Accepted replica exchanges
+    BYTES_SENT,       // Bytes sent over MPI
+    POLISH_FLIPS,     // Flips of the steepest descent after annealing
+    CLUSTER_MOVES,    // Cluster move proposals
+    CLUSTER_ACCEPTS,  // Accepted cluster moves
+    CLUSTER_SPINS,    // Spins flipped by accepted cluster moves
+    COUNTER_COUNT
+};
+
+// Plain snapshot of the probes, what is gathered across MPI ranks
+struct Report {
+    double seconds[TIMER_COUNT]  = {};
+    long calls[TIMER_COUNT]      = {};
+    long counters[COUNTER_COUNT] = {};
+};
+
+extern std::atomic<double> timer_seconds[TIMER_COUNT];
+extern std::atomic<long> timer_calls[TIMER_COUNT];
+extern std::atomic<long> counter_values[COUNTER_COUNT];
+
+inline void add (const Counter& c, const long& n) {
+    counter_values[c].fetch_add(n, std::memory_order_relaxed);
+}
+
+class ScopedTimer {
+  private:
+    Timer timer;
+    std::chrono::steady_clock::time_point start;
+
+  public:
+    ScopedTimer (const Timer& t) : timer(t), start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer () {
+        const std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+        timer_seconds[timer].fetch_add(d.count(), std::memory_order_relaxed);
+        timer_calls[timer].fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+Report snapshot();                                         // Current values of every probe
+void writeJson(std::ostream&, const std::vector<Report>&); // One report per rank
+
+} // namespace profile
+
+#ifdef NO_PROFILE
+#define PROFILE_SCOPE(timer)
+#define PROFILE_COUNT(counter, n)
+#else
+#define PROFILE_CONCAT_(a, b)     a##b
+#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(timer)      profile::ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__)(timer)
+#define PROFILE_COUNT(counter, n) profile::add(counter, n)
+#endif
+
+#endif
@@ -1,33 +1,70 @@
 #include "./args/Args.h"
+#include "./graph/IdMap.h"
+#include "./graph/preprocess/preprocess.h"
 #include "./graph/tri/tri.h"
+#include "./jobs/jobs.h"
+#include "./profile/Profile.h"
 #include "./runhelper.h"
+#include "./serve/serve.h"
 #include "run.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cfloat>
+#include <cstdlib>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <stdarg.h>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
+#include "./algo/pa/pa.h"
+#include "./algo/psa/psa.h"
 #include "./algo/sa/sa.h"
 #include "./algo/sqa/sqa.h"
+#include "./algo/tabu/tabu.h"
+#include "./algo/wl/wl.h"
+#include "./annealer/TempRange.h"
 #include "graph/Graph.h"
 
+#ifdef USE_MPI
+#include "./annealer/MpiAnnealer.h"
+#endif
+
 #define debug(n) std::cerr << n << std::endl;
 
 // Make graph with length, height and gamma
 Graph makeGraph(const int&, const int&, const double& gamma);
 
-void readSpins (const std::string& filename, Anlr_SA& graph) {
-    std::vector<Spin> spins;
+// A line of an input file, with the spin IDs as written
+struct InputLine {
+    int arity; // Spin IDs of the line: 0 (constant), 1 (field) or 2 (coupling)
+    int64_t id[2];
+    double value;
+};
+
+std::vector<InputLine> readLines(std::fstream&);
+IdMap mapIds(const std::vector<InputLine>&);
+template <typename G> void pushLines(const std::vector<InputLine>&, const IdMap&, const bool&, G&);
+
+// Set the spins of an annealer from "id spin" lines, labels[i] is the input ID of spin i (empty
+// when the IDs are the indices). IDs that are not spins of the graph are skipped.
+template <typename A>
+void readSpins (const std::string& filename, A& graph, const std::vector<int64_t>& labels) {
+    std::unordered_map<int64_t, int> index_of;
+    for (int i = 0; i < (int)labels.size(); ++i)
+        index_of.emplace(labels[i], i);
     std::fstream file;
     file.open(filename, std::ios::in);
     std::string line;
-    std::vector<int> v;
-    int i;
+    std::vector<int64_t> v;
+    int64_t i;
 
     while (std::getline(file, line)) {
         if (line[0] == '#') continue; // Skip comment line
@@ -38,24 +75,239 @@ void readSpins (const std::string& filename, Anlr_SA& graph) {
             v.push_back(i);
 
         switch (v.size()) {
-            case 2: graph.setSpins(v[0], v[1]); break;
+            case 2:
+                if (labels.empty()) graph.setSpins(v[0], v[1]);
+                else if (index_of.count(v[0])) graph.setSpins(index_of[v[0]], v[1]);
+                break;
             default: break;
         }
     }
 }
 
-int run (int argc, char **argv, const int myrank) {
+// Checkpoint file of a replica: <prefix>.<rank>
+std::string checkpointPath (const std::string& prefix, const int& rank) {
+    return custom_format("%s.%04d", prefix.c_str(), rank);
+}
+
+// Seed the generator, set the stop and checkpoint policies of a replica. The replicas of a
+// process run one after another and share the --time-limit budget.
+void setupReplica (const CustomArgs& args, Annealer& anlr, const int& rank, const int& replicas) {
+    if (args.hasArg("--seed")) anlr.setSeed(std::get<int>(args.getArg("--seed")) + rank);
+
+    StopPolicy stop;
+    if (args.hasArg("--time-limit"))
+        stop.time_limit = std::get<double>(args.getArg("--time-limit")) / replicas;
+    if (args.hasArg("--stop-on-stagnation"))
+        stop.stagnation = std::get<int>(args.getArg("--stop-on-stagnation"));
+    if (args.hasArg("--target-energy")) {
+        stop.has_target    = true;
+        stop.target_energy = std::get<double>(args.getArg("--target-energy"));
+    }
+    anlr.setStop(stop);
+
+    if (args.hasArg("--op-every"))
+        anlr.setOrderTracking(std::get<int>(args.getArg("--h-tri")),
+                              std::get<int>(args.getArg("--op-every")));
+    else if (args.hasArg("--measure") && args.hasArg("--h-tri"))
+        anlr.setOrderTracking(std::get<int>(args.getArg("--h-tri")), 0); // Sampled by measure
+
+    if (!args.hasArg("--checkpoint")) return;
+
+    CheckpointPolicy policy;
+    policy.path = checkpointPath(std::get<std::string>(args.getArg("--checkpoint")), rank);
+    if (args.hasArg("--checkpoint-every"))
+        policy.every_sweeps = std::get<int>(args.getArg("--checkpoint-every"));
+    if (args.hasArg("--checkpoint-secs"))
+        policy.every_secs = std::get<double>(args.getArg("--checkpoint-secs"));
+    if (policy.every_sweeps == 0 && policy.every_secs == 0.0) policy.every_sweeps = 1000;
+    anlr.setCheckpoint(policy);
+    return;
+}
+
+// Equilibrium run of --measure in place of the anneal, at inverse temperature beta
+template <typename A>
+Measurement measureReplica (const CustomArgs& args, A& anlr, const double& beta) {
+    const int sweeps     = std::get<int>(args.getArg("--measure"));
+    const int thermalize = args.hasArg("--thermalize")
+                               ? std::get<int>(args.getArg("--thermalize"))
+                               : sweeps / 10;
+    Measurement m(anlr.getLength(), beta);
+    anlr.measure(m, thermalize, sweeps);
+    return m;
+}
+
+// Schedule of the temperature / gamma (--schedule, --sweeps-per-step)
+template <typename P>
+void setupSchedule (const CustomArgs& args, P& params) {
+    if (args.hasArg("--schedule"))
+        params.schedule = Schedule::fromName(std::get<std::string>(args.getArg("--schedule")));
+    if (args.hasArg("--sweeps-per-step"))
+        params.sweeps_per_step = std::get<int>(args.getArg("--sweeps-per-step"));
+    return;
+}
+
+// Schedule endpoints of --auto-temp, shared by every replica (explicit --ini-* / --final-* win)
+TempRange autoRange (const CustomArgs& args, const Graph& graph, const ANNEAL_FUNC& strategy) {
+    // Sample with --seed so every rank and every rerun derives the same range
+    std::mt19937 generator(args.hasArg("--seed") ? std::get<int>(args.getArg("--seed")) : 0);
+    const std::vector<double> uphill = sampleUphill(graph, generator);
+    if (uphill.empty()) {
+        std::cerr << "--auto-temp: no uphill flip found, keeping the default range" << std::endl;
+        return strategy == SQA ? TempRange { Params_SQA().init_g, Params_SQA().final_g }
+                               : TempRange { Params_SA().init_t, Params_SA().final_t };
+    }
+
+    double p_init = AUTO_ACCEPT_INIT, p_final = AUTO_ACCEPT_FINAL;
+    if (args.hasArg("--auto-accept")) {
+        const std::vector<double> p = std::get<std::vector<double> >(args.getArg("--auto-accept"));
+        p_init                      = p[0];
+        p_final                     = p[1];
+    }
+    if (strategy == SQA && args.hasArg("--auto-accept"))
+        std::cerr << "--auto-accept: not used by --func sqa, gamma is only rescaled" << std::endl;
+    const TempRange range =
+        strategy == SQA ? autoGammaRange(uphill) : autoTempRange(uphill, p_init, p_final);
+    std::cout << "Auto range: " << range.init << " -> " << range.final << std::endl;
+    return range;
+}
+
+// Fix what --preprocess can fix and split the rest of the graph into components
+preprocess::Reduction reduceGraph (const Graph& graph) {
+    PROFILE_SCOPE(profile::PREPROCESS);
+    const preprocess::Reduction r = preprocess::reduce(graph);
+    int largest = 0;
+    for (const std::vector<int>& component : r.components)
+        largest = std::max(largest, (int)component.size());
+    std::cout << "Preprocess: " << r.dominance << " spins fixed by dominance, " << r.persistency
+              << " by roof duality, " << r.components.size() << " components (largest "
+              << largest << " spins)" << std::endl;
+    return r;
+}
+
+// Anneal every component of --preprocess on its own, the components are spread over --threads
+// workers. Returns an annealer of the whole graph holding the expanded configuration.
+template <typename A, typename P>
+A annealComponents (const CustomArgs& args, const Graph& graph, const preprocess::Reduction& r,
+                    P params, const int& rank, const int& replicas,
+                    const std::shared_ptr<std::atomic<bool> >& cancel) {
+    const int count = r.graphs.size();
+    int workers     = args.hasArg("--threads") ? std::get<int>(args.getArg("--threads")) : 1;
 #ifdef USE_MPI
-    printf("rank = %d\n", myrank);
+    workers = 1; // Every rank exchanges the components in the same order
 #endif
-    CustomArgs args(argc, argv);
-    ANNEAL_FUNC strategy = args.getStrategy();
+    workers          = std::max(1, std::min(workers, count));
+    const int rounds = (count + workers - 1) / workers;
+    params.threads   = std::max(1, params.threads / workers);
+    std::vector<std::vector<Spin> > configs(count);
+    std::vector<std::exception_ptr> errors(workers);
+    std::vector<std::thread> pool;
+    for (int w = 0; w < workers; ++w)
+        pool.emplace_back([&, w] () {
+            try {
+                for (int c = w; c < count; c += workers) {
+                    A anlr(r.graphs[c], params);
+                    setupReplica(args, anlr, rank, replicas * rounds);
+                    if (args.hasArg("--seed")) {
+                        // Every component draws its own stream
+                        std::seed_seq seq { std::get<int>(args.getArg("--seed")) + rank, c };
+                        unsigned int seed;
+                        seq.generate(&seed, &seed + 1);
+                        anlr.setSeed(seed);
+                    }
+                    anlr.setCancel(cancel);
+                    anlr.anneal();
+                    if (args.hasArg("--polish")) anlr.polish();
+                    configs[c] = anlr.getSpins();
+                }
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+    for (std::thread& worker : pool)
+        worker.join();
+    for (const std::exception_ptr& error : errors)
+        if (error) std::rethrow_exception(error);
+
+    A whole(graph, params);
+    const std::vector<Spin> spins = preprocess::expand(r, configs);
+    for (int i = 0; i < (int)spins.size(); ++i)
+        whole.setSpins(i, spins[i]);
+    return whole;
+}
 
-    if (strategy == NIL) strategy = SA; // Default strategy is SA
+// Checkpoint to resume a replica from (--resume)
+Checkpoint resumePoint (const CustomArgs& args, const int& rank) {
+    return readCheckpoint(checkpointPath(std::get<std::string>(args.getArg("--resume")), rank));
+}
 
-    std::fstream file;
-    Graph graph;
+#ifdef USE_MPI
+// Anneal a single graph split across all MPI ranks (--partition)
+int runPartition (const CustomArgs& args, const int myrank) {
+    struct Params_SA params = { .rank = myrank };
+    if (args.hasArg("--ini-t")) params.init_t = std::get<double>(args.getArg("--ini-t"));
+    if (args.hasArg("--final-t")) params.final_t = std::get<double>(args.getArg("--final-t"));
+    if (args.hasArg("--tau")) params.tau = std::get<int>(args.getArg("--tau"));
+    setupSchedule(args, params);
+
+    std::vector<int> offsets;
+    std::vector<InputLine> lines;
+    IdMap ids;
+    if (args.hasArg("--h-tri")) {
+        // Slabs of whole rows of the triangular lattice
+        const int tri_width = std::get<int>(args.getArg("--h-tri"));
+        offsets             = MpiPartition::sliceOffsets(tri_width, tri_width);
+    } else {
+        std::fstream file(std::get<std::string>(args.getArg("--file")), std::ios::in);
+        lines   = readLines(file);
+        ids     = mapIds(lines);
+        offsets = MpiPartition::blockOffsets(ids.size());
+    }
+
+    Anlr_PSA psa(MpiPartition(offsets), params);
+    {
+        PROFILE_SCOPE(profile::PARSE);
+        if (args.hasArg("--h-tri")) {
+            const int tri_width = std::get<int>(args.getArg("--h-tri"));
+            const int row_begin = offsets[myrank] / tri_width;
+            const int row_end   = offsets[myrank + 1] / tri_width;
+            // The row above the slab links into it, skip it when the slab is the whole lattice
+            const int first_row = (row_end - row_begin == tri_width) ? row_begin : row_begin - 1;
+            tri::pushEdges(tri_width, first_row, row_end,
+                           [&] (const int& po1, const int& po2, const double& co) {
+                               psa.pushBack(po1, po2, co);
+                           });
+        } else {
+            pushLines(lines, ids, args.hasArg("--qubo"), psa);
+        }
+        psa.lockPartition();
+    }
+    setupReplica(args, psa, myrank, 1);
+    if (args.hasArg("--resume")) psa.resume(resumePoint(args, myrank));
+
+    std::cout << std::setprecision(10); // Set precision to 10 digits
+    const double initial_energy = psa.getHamiltonianEnergy();
+    if (myrank == 0) {
+        std::cout << "Hamiltonian energy: " << initial_energy << std::endl;
+        std::cout << "Partitioned Simulated Annealing (" << psa.getColorCount() << " phases)"
+                  << std::endl;
+    }
+
+    const double hamiltonian_energy = psa.anneal();
+    if (myrank == 0) std::cout << hamiltonian_energy << std::endl;
 
+    if (args.hasArg("--print-conf")) {
+        PROFILE_SCOPE(profile::OUTPUT);
+        printPSA(psa, params, ids.getIds());
+    }
+
+    return 0;
+}
+#endif
+
+// Build the graph of --h-tri or --file, labels gets the input ID of every spin of a --file graph
+Graph loadGraph (const CustomArgs& args, std::vector<int64_t>& labels) {
+    PROFILE_SCOPE(profile::PARSE);
+    Graph graph;
     if (args.hasArg("--h-tri")) {
         /*
          * Build graph for triangular lattice
@@ -68,52 +320,179 @@ int run (int argc, char **argv, const int myrank) {
         /*
          * Build graph for general purpose
          */
+        std::fstream file;
         file.open(std::get<std::string>(args.getArg("--file")), std::ios::in);
-        graph = args.hasArg("--qubo") ? readInputFromQubo(file)
-                                      : readInput(file); // Convert to Ising if it's QUBO
+        IdMap ids;
+        graph = args.hasArg("--qubo") ? readInputFromQubo(file, ids)
+                                      : readInput(file, ids); // Convert to Ising if it's QUBO
         if (file.is_open()) file.close();
+        labels = ids.getIds();
 
         // Lock the length of the graph after reading the input
         graph.lockLength();
     }
+    return graph;
+}
+
+// Relabel the spins of --reorder so neighbours sit close in memory, the labels follow the spins
+void reorderGraph (const CustomArgs& args, Graph& graph, std::vector<int64_t>& labels) {
+    if (!args.hasArg("--reorder")) return;
+    PROFILE_SCOPE(profile::PREPROCESS);
+    const std::string method = std::get<std::string>(args.getArg("--reorder"));
+    std::vector<int> order   = graph.getOrdering(method == "rcm");
+    if (method == "rcm") std::reverse(order.begin(), order.end());
+    graph = graph.permute(order);
+    std::vector<int64_t> permuted(order.size());
+    for (int k = 0; k < (int)order.size(); ++k)
+        permuted[k] = labels[order[k]];
+    labels.swap(permuted);
+    return;
+}
+
+// Write the run profile (--profile), gathered from every rank under MPI
+void writeProfile (const std::string& filename, const int myrank) {
+    std::vector<profile::Report> reports = { profile::snapshot() };
+#ifdef USE_MPI
+    reports = gatherProfile(reports[0]);
+#endif
+    if (myrank != 0) return;
+    std::ofstream outfile(filename, std::ios::out);
+    profile::writeJson(outfile, reports);
+    return;
+}
+
+int runReplicas(const CustomArgs&, const int);
+
+int run (int argc, char **argv, const int myrank) {
+#ifdef USE_MPI
+    printf("rank = %d\n", myrank);
+#endif
+    CustomArgs args(argc, argv);
+    int status = 0;
+
+    {
+        PROFILE_SCOPE(profile::TOTAL);
+        if (args.hasArg("--serve")) {
+            status = serve::run(args);
+        } else if (args.hasArg("--jobs")) {
+            status = jobs::run(args);
+        } else if (args.hasArg("--partition")) {
+#ifdef USE_MPI
+            status = runPartition(args, myrank);
+#else
+            std::cerr << "--partition requires the MPI build (make mpi)" << std::endl;
+            return 1;
+#endif
+        } else {
+            status = runReplicas(args, myrank);
+        }
+    }
+
+    if (args.hasArg("--profile"))
+        writeProfile(std::get<std::string>(args.getArg("--profile")), myrank);
+    return status;
+}
+
+// Anneal --ans-count independent replicas of the graph (one per rank under MPI)
+int runReplicas (const CustomArgs& args, const int myrank) {
+    ANNEAL_FUNC strategy = args.getStrategy();
+
+    if (strategy == NIL) strategy = SA; // Default strategy is SA
+
+    std::vector<int64_t> labels; // Input ID of every spin, empty for --h-tri
+    Graph graph = loadGraph(args, labels);
+    reorderGraph(args, graph, labels);
 
     std::cout << std::setprecision(10); // Set precision to 10 digits
     std::cout << "Hamiltonian energy: " << graph.getHamiltonianEnergy() << std::endl;
     switch (strategy) {
         case SA: std::cout << "Simulated Annealing" << std::endl; break;
         case SQA: std::cout << "Simulated Quantum Annealing" << std::endl; break;
+        case TABU: std::cout << "Tabu Search" << std::endl; break;
+        case PA: std::cout << "Population Annealing" << std::endl; break;
+        case WL: std::cout << "Wang-Landau Sampling" << std::endl; break;
         default: break;
     }
 
-    std::variant<Params_SA, Params_SQA> prms;
-    std::variant<Anlr_SA, Anlr_SQA> anlr;
+    std::variant<Params_SA, Params_SQA, Params_TABU, Params_PA, Params_WL> prms;
+    std::variant<Anlr_SA, Anlr_SQA, Anlr_TABU, Anlr_PA, Anlr_WL> anlr;
     double hamiltonian_energy = DBL_MAX;
 
+    TempRange auto_range = {};
+    if (args.hasArg("--auto-temp")) auto_range = autoRange(args, graph, strategy);
+
+    preprocess::Reduction reduction;
+    if (args.hasArg("--preprocess")) reduction = reduceGraph(graph);
+
     int rank_count = 1;
     if (args.hasArg("--ans-count")) rank_count = std::get<int>(args.getArg("--ans-count"));
+#ifdef USE_MPI
+    rank_count = 1; // Every MPI rank is one replica, exchanging with its neighbor
+#endif
 
-    for (int rank = 0; rank < rank_count; ++rank) {
+    // Set by the first replica reaching --target-energy, the others stop
+    std::shared_ptr<std::atomic<bool> > cancel = std::make_shared<std::atomic<bool> >(false);
+
+    for (int r = 0; r < rank_count; ++r) {
+        if (cancel->load()) {
+            std::cout << "Target energy reached, skipping the remaining replicas" << std::endl;
+            break;
+        }
+        const int rank = r + myrank;
         switch (strategy) {
             case SA:
                 {
                     struct Params_SA params = { .rank = rank };
+                    if (args.hasArg("--auto-temp")) {
+                        params.init_t  = auto_range.init;
+                        params.final_t = auto_range.final;
+                    }
                     if (args.hasArg("--ini-t"))
                         params.init_t = std::get<double>(args.getArg("--ini-t"));
                     if (args.hasArg("--final-t"))
                         params.final_t = std::get<double>(args.getArg("--final-t"));
                     if (args.hasArg("--tau")) params.tau = std::get<int>(args.getArg("--tau"));
+                    params.houdayer = args.hasArg("--houdayer");
+                    if (args.hasArg("--cluster")) {
+                        const std::string name = std::get<std::string>(args.getArg("--cluster"));
+                        params.cluster_move    = cluster::fromName(name);
+                    }
+                    if (args.hasArg("--h-tri"))
+                        params.tri_length = std::get<int>(args.getArg("--h-tri"));
+                    if (args.hasArg("--threads"))
+                        params.threads = std::get<int>(args.getArg("--threads"));
+                    setupSchedule(args, params);
+                    if (args.hasArg("--preprocess")) {
+                        Anlr_SA sa = annealComponents<Anlr_SA>(args, graph, reduction, params, rank,
+                                                               rank_count, cancel);
+                        hamiltonian_energy = sa.getHamiltonianEnergy();
+                        anlr               = std::move(sa);
+                        prms               = params;
+                        break;
+                    }
                     Anlr_SA sa(graph, params);
 
                     if (args.hasArg("--print-progress")) sa.print_progress = true;
 
                     if (args.hasArg("--spin-conf")) {
                         std::string filename = std::get<std::string>(args.getArg("--spin-conf"));
-                        readSpins(filename, sa);
+                        readSpins(filename, sa, labels);
                     }
 
-                    hamiltonian_energy = sa.anneal();
+                    setupReplica(args, sa, rank, rank_count);
+                    sa.setCancel(cancel);
+                    if (args.hasArg("--resume")) sa.resume(resumePoint(args, rank));
 
-                    anlr = sa;
+                    if (args.hasArg("--measure")) {
+                        const Measurement m = measureReplica(args, sa, 1 / params.init_t);
+                        printMeasureSA(m, sa, params);
+                        hamiltonian_energy = m.meanEnergy();
+                    } else {
+                        hamiltonian_energy = sa.anneal();
+                    }
+                    if (args.hasArg("--polish")) hamiltonian_energy = sa.polish();
+
+                    anlr = std::move(sa);
                     prms = params;
 
                     break;
@@ -121,6 +500,10 @@ int run (int argc, char **argv, const int myrank) {
             case SQA:
                 {
                     struct Params_SQA params = { .rank = rank };
+                    if (args.hasArg("--auto-temp")) {
+                        params.init_g  = auto_range.init;
+                        params.final_g = auto_range.final;
+                    }
                     if (args.hasArg("--ini-g"))
                         params.init_g = std::get<double>(args.getArg("--ini-g"));
                     if (args.hasArg("--final-g"))
@@ -130,10 +513,111 @@ int run (int argc, char **argv, const int myrank) {
                         params.layer_count = std::get<int>(args.getArg("--height"));
                     if (args.hasArg("--gamma"))
                         params.gamma = std::get<double>(args.getArg("--gamma"));
+                    params.worldline = args.hasArg("--worldline");
+                    setupSchedule(args, params);
                     Anlr_SQA sqa(graph, params);
-                    hamiltonian_energy = sqa.anneal();
+                    setupReplica(args, sqa, rank, rank_count);
+                    sqa.setCancel(cancel);
+                    if (args.hasArg("--resume")) sqa.resume(resumePoint(args, rank));
+                    if (args.hasArg("--measure")) {
+                        // The sweeps accept exp(-delta E), the couplings carry the temperature
+                        const Measurement m = measureReplica(args, sqa, 1.0);
+                        printMeasureSQA(m, sqa, params);
+                        hamiltonian_energy = m.meanEnergy();
+                    } else {
+                        hamiltonian_energy = sqa.anneal();
+                    }
+                    if (args.hasArg("--polish")) hamiltonian_energy = sqa.polish();
+
+                    anlr = std::move(sqa);
+                    prms = params;
+
+                    break;
+                }
+            case TABU:
+                {
+                    struct Params_TABU params = { .rank = rank };
+                    if (args.hasArg("--tau")) params.tau = std::get<int>(args.getArg("--tau"));
+                    if (args.hasArg("--tenure"))
+                        params.tenure = std::get<int>(args.getArg("--tenure"));
+                    if (args.hasArg("--starts"))
+                        params.starts = std::get<int>(args.getArg("--starts"));
+                    if (args.hasArg("--threads"))
+                        params.threads = std::get<int>(args.getArg("--threads"));
+                    if (args.hasArg("--preprocess")) {
+                        Anlr_TABU tabu = annealComponents<Anlr_TABU>(args, graph, reduction, params,
+                                                                     rank, rank_count, cancel);
+                        hamiltonian_energy = tabu.getHamiltonianEnergy();
+                        anlr               = std::move(tabu);
+                        prms               = params;
+                        break;
+                    }
+                    Anlr_TABU tabu(graph, params);
+
+                    if (args.hasArg("--spin-conf")) {
+                        std::string filename = std::get<std::string>(args.getArg("--spin-conf"));
+                        readSpins(filename, tabu, labels);
+                    }
+
+                    setupReplica(args, tabu, rank, rank_count);
+                    tabu.setCancel(cancel);
+                    hamiltonian_energy = tabu.anneal();
+                    if (args.hasArg("--polish")) hamiltonian_energy = tabu.polish();
+
+                    anlr = std::move(tabu);
+                    prms = params;
 
-                    anlr = sqa;
+                    break;
+                }
+            case PA:
+                {
+                    struct Params_PA params = { .rank = rank };
+                    if (args.hasArg("--auto-temp")) {
+                        params.init_t  = auto_range.init;
+                        params.final_t = auto_range.final;
+                    }
+                    if (args.hasArg("--ini-t"))
+                        params.init_t = std::get<double>(args.getArg("--ini-t"));
+                    if (args.hasArg("--final-t"))
+                        params.final_t = std::get<double>(args.getArg("--final-t"));
+                    if (args.hasArg("--tau")) params.tau = std::get<int>(args.getArg("--tau"));
+                    if (args.hasArg("--population"))
+                        params.population = std::get<int>(args.getArg("--population"));
+                    if (args.hasArg("--threads"))
+                        params.threads = std::get<int>(args.getArg("--threads"));
+                    setupSchedule(args, params);
+                    Anlr_PA pa(graph, params);
+                    setupReplica(args, pa, rank, rank_count);
+                    pa.setCancel(cancel);
+                    hamiltonian_energy = pa.anneal();
+                    std::cout << "Free energy: " << pa.getFreeEnergy() << std::endl;
+                    if (args.hasArg("--polish")) hamiltonian_energy = pa.polish();
+
+                    anlr = std::move(pa);
+                    prms = params;
+
+                    break;
+                }
+            case WL:
+                {
+                    struct Params_WL params = { .rank = rank };
+                    if (args.hasArg("--tau")) params.tau = std::get<int>(args.getArg("--tau"));
+                    if (args.hasArg("--threads"))
+                        params.threads = std::get<int>(args.getArg("--threads"));
+                    params.windows = args.hasArg("--windows")
+                                         ? std::get<int>(args.getArg("--windows"))
+                                         : params.threads;
+                    if (args.hasArg("--flatness"))
+                        params.flatness = std::get<double>(args.getArg("--flatness"));
+                    if (args.hasArg("--final-lnf"))
+                        params.final_lnf = std::get<double>(args.getArg("--final-lnf"));
+                    Anlr_WL wl(graph, params);
+                    setupReplica(args, wl, rank, rank_count);
+                    wl.setCancel(cancel);
+                    hamiltonian_energy = wl.anneal();
+                    printDensity(wl, params); // The density of states is the result
+
+                    anlr = std::move(wl);
                     prms = params;
 
                     break;
@@ -143,11 +627,23 @@ int run (int argc, char **argv, const int myrank) {
 
         std::cout << hamiltonian_energy << std::endl;
 
+        if (args.hasArg("--op-every")) {
+            PROFILE_SCOPE(profile::OUTPUT);
+            if (strategy == SA) printOrderSA(std::get<Anlr_SA>(anlr), std::get<Params_SA>(prms));
+            else printOrderSQA(std::get<Anlr_SQA>(anlr), std::get<Params_SQA>(prms));
+        }
+
         if (!args.hasArg("--print-conf")) continue; // Program end if --print-conf is not set
+        PROFILE_SCOPE(profile::OUTPUT);
 
         switch (strategy) {
-            case SA: printSAV2(std::get<Anlr_SA>(anlr), std::get<Params_SA>(prms)); break;
-            case SQA: printSQA(std::get<Anlr_SQA>(anlr), std::get<Params_SQA>(prms)); break;
+            case SA: printSAV2(std::get<Anlr_SA>(anlr), std::get<Params_SA>(prms), labels); break;
+            case SQA: printSQA(std::get<Anlr_SQA>(anlr), std::get<Params_SQA>(prms), labels); break;
+            case TABU:
+                printTABU(std::get<Anlr_TABU>(anlr), std::get<Params_TABU>(prms), labels);
+                break;
+            case PA: printPA(std::get<Anlr_PA>(anlr), std::get<Params_PA>(prms), labels); break;
+            case WL: printWL(std::get<Anlr_WL>(anlr), std::get<Params_WL>(prms), labels); break;
             default: break;
         }
 
@@ -157,6 +653,10 @@ int run (int argc, char **argv, const int myrank) {
             switch (strategy) {
                 case SA: printTriSA(std::get<Anlr_SA>(anlr), std::get<Params_SA>(prms)); break;
                 case SQA: printTriSQA(std::get<Anlr_SQA>(anlr), std::get<Params_SQA>(prms)); break;
+                case TABU:
+                    printTriTABU(std::get<Anlr_TABU>(anlr), std::get<Params_TABU>(prms));
+                    break;
+                case PA: printTriPA(std::get<Anlr_PA>(anlr), std::get<Params_PA>(prms)); break;
                 default: break;
             }
         }
@@ -165,58 +665,104 @@ int run (int argc, char **argv, const int myrank) {
     return 0;
 }
 
-Graph readInputFromQubo (std::fstream& source) {
-    double d;
-    Graph graph;
+// Parse the lines of source, the last value of a line is its coefficient and the ones before
+// are spin IDs
+std::vector<InputLine> readLines (std::fstream& source) {
+    std::vector<InputLine> lines;
     std::string line;
-    std::vector<double> v;
     while (std::getline(source, line)) {
-        v.clear();
-        std::stringstream ss(line);
+        if (line[0] == '#') continue; // Skip comment line
 
-        while (ss >> d)
-            v.push_back(d);
+        // Numbers are read as doubles first, the IDs are parsed again as integers
+        const char *begin[4];
+        int size     = 0;
+        double value = 0.0;
+        for (const char *p = line.c_str(); size < 4;) {
+            char *end;
+            const double d = std::strtod(p, &end);
+            if (end == p) break;
+            begin[size++] = p;
+            value         = d;
+            p             = end;
+        }
 
-        switch (v.size()) {
-            case 1: graph.pushBack(v[1]); break;
-            case 2:
-                graph.pushBack(v[0], v[1] / 2); // pushBack(k/2, index)
-                graph.pushBack(v[1] / 2);
+        if (size == 0 || size > 3)
+            throw std::invalid_argument("Invalid input, size = " + std::to_string(size));
+        InputLine input = { size - 1, { 0, 0 }, value };
+        for (int k = 0; k < input.arity; ++k)
+            input.id[k] = std::strtoll(begin[k], nullptr, 10);
+        lines.push_back(input);
+    }
+    return lines;
+}
+
+// Dense indices of the spin IDs of the lines
+IdMap mapIds (const std::vector<InputLine>& lines) {
+    std::vector<int64_t> ids;
+    ids.reserve(2 * lines.size());
+    for (const InputLine& input : lines)
+        for (int k = 0; k < input.arity; ++k)
+            ids.push_back(input.id[k]);
+    return IdMap(std::move(ids));
+}
+
+// Push the lines into graph (Graph or any type with the same pushBack overloads) by dense index.
+// QUBO lines are converted to Ising, x = (1 + s) / 2.
+template <typename G>
+void pushLines (const std::vector<InputLine>& lines, const IdMap& ids, const bool& qubo, G& graph) {
+    for (const InputLine& input : lines) {
+        const int i     = input.arity > 0 ? ids.index(input.id[0]) : 0;
+        const int j     = input.arity > 1 ? ids.index(input.id[1]) : 0;
+        const double co = input.value;
+        switch (input.arity) {
+            case 0: graph.pushBack(co); break;
+            case 1:
+                if (!qubo) {
+                    graph.pushBack(i, co);
+                    break;
+                }
+                graph.pushBack(i, co / 2); // pushBack(index, k/2)
+                graph.pushBack(co / 2);
                 break;
-            case 3: // v[0]: po1, v[1]: po2, v[2]: co
-                graph.pushBack(v[0], v[1], v[2] / 4);
-                graph.pushBack(v[0], v[2] / 4);
-                graph.pushBack(v[1], v[2] / 4);
-                graph.pushBack(v[2] / 4);
+            case 2:
+                if (!qubo) {
+                    graph.pushBack(i, j, co);
+                    break;
+                }
+                graph.pushBack(i, j, co / 4);
+                graph.pushBack(i, co / 4);
+                graph.pushBack(j, co / 4);
+                graph.pushBack(co / 4);
                 break;
-            default: std::cerr << "Invalid input, size = " << v.size() << std::endl; exit(1);
+            default: break;
         }
     }
-    return graph;
+    return;
 }
 
-Graph readInput (std::fstream& source) {
-    double d;
+Graph readInputFromQubo (std::fstream& source, IdMap& ids) {
+    const std::vector<InputLine> lines = readLines(source);
+    ids                                = mapIds(lines);
     Graph graph;
-    std::string line;
-    std::vector<double> v;
-    while (std::getline(source, line)) {
-        if (line[0] == '#') continue; // Skip comment line
-        v.clear();
-        std::stringstream ss(line);
-
-        while (ss >> d)
-            v.push_back(d);
+    pushLines(lines, ids, true, graph);
+    return graph;
+}
+Graph readInputFromQubo (std::fstream& source) {
+    IdMap ids;
+    return readInputFromQubo(source, ids);
+}
 
-        switch (v.size()) {
-            case 1: graph.pushBack(v[0]); break;
-            case 2: graph.pushBack(v[0], v[1]); break;
-            case 3: graph.pushBack(v[0], v[1], v[2]); break;
-            default: std::cerr << "Invalid input, size = " << v.size() << std::endl; exit(1);
-        }
-    }
+Graph readInput (std::fstream& source, IdMap& ids) {
+    const std::vector<InputLine> lines = readLines(source);
+    ids                                = mapIds(lines);
+    Graph graph;
+    pushLines(lines, ids, false, graph);
     return graph;
 }
+Graph readInput (std::fstream& source) {
+    IdMap ids;
+    return readInput(source, ids);
+}
 
 void testSpin (int index, Graph graph) {
     graph.flipSpin(index);
@@ -1,5 +1,6 @@
 #include "./annealer/Annealer.h"
 #include "./graph/Graph.h"
+#include "./graph/IdMap.h"
 
 #include <fstream>
 #include <string>
@@ -18,7 +19,9 @@
 /* Helper functions */
 
 Graph readInput(std::fstream&);
+Graph readInput(std::fstream&, IdMap&); // ids gets the input ID of every spin
 Graph readInputFromQubo(std::fstream&);
+Graph readInputFromQubo(std::fstream&, IdMap&);
 void testSpin(int, Graph); // Cout index, graph and energy
 
 int run(int, char **, const int);
@@ -2,6 +2,8 @@
 #include "graph/tri/tri.h"
 #include "runhelper.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdarg>
 #include <cstring>
 #include <iomanip>
@@ -52,14 +54,37 @@ std::string getTriName (const ANNEAL_FUNC& a) {
     }
 }
 
-void printSAV2 (const Anlr_SA& sa, const Params_SA& p) {
+// "sweep T|gamma squared_op" lines of the --op-every samples
+static void writeOrder (const std::string& filename, const std::string& parameter,
+                        const std::vector<OrderSample>& samples) {
+    std::ofstream outfile(filename, std::ios::out);
+    outfile << "sweep\t" << parameter << "\tsquared_op\n" << std::setprecision(10);
+    for (const OrderSample& s : samples)
+        outfile << s.sweep << "\t" << s.parameter << "\t" << s.squared << "\n";
+    return;
+}
+
+// "id spin" lines of every spin in input order, labels[i] is the input ID of spin i (empty when
+// the IDs are the indices)
+static void writeSpins (std::ofstream& outfile, const std::vector<Spin>& spins,
+                        const std::vector<int64_t>& labels) {
+    std::vector<std::pair<int64_t, Spin> > lines(spins.size());
+    for (int i = 0; i < (int)spins.size(); ++i)
+        lines[i] = { labels.empty() ? i : labels[i], spins[i] };
+    std::sort(lines.begin(), lines.end());
+    for (const std::pair<int64_t, Spin>& line : lines)
+        outfile << line.first << " " << line.second << std::endl;
+    return;
+}
+
+void printSAV2 (const Anlr_SA& sa, const Params_SA& p, const std::vector<int64_t>& labels) {
     const int l = sa.getLength(), h = sa.getHeight(), t = p.tau, r = p.rank;
     const double it = p.init_t, ft = p.final_t;
+    const std::vector<Spin> spins = sa.getSpins();
     std::ofstream outfile;
 
-    // Count total spins
-    std::map<int, std::vector<int> > map = sa.getGraph().getAdjMap();
-    const int total_spins                = map.size();
+    // Every spin of the graph has a term, the input IDs are mapped to 0..N-1
+    const int total_spins = spins.size();
 
     std::string filename =
         custom_format("conf_N%d_T%f_tau%d_%04d.dat", total_spins, p.init_t, p.tau, r);
@@ -69,10 +94,7 @@ void printSAV2 (const Anlr_SA& sa, const Params_SA& p) {
     outfile.open(filename, std::ios::out);
     outfile << std::setprecision(10) << sa.getHamiltonianEnergy() << std::endl;
 
-    for (int i = 0; i < sa.getLength(); ++i) {
-        if (map.count(i) == 0) continue;
-        outfile << i << " " << sa.getSpins()[i] << std::endl;
-    }
+    writeSpins(outfile, spins, labels);
 }
 
 void printSA (const Anlr_SA& sa, const Params_SA& p) {
@@ -103,7 +125,23 @@ void printTriSA (const Anlr_SA& sa, const Params_SA& p) {
     outfile.close();
 }
 
-void printSQA (const Anlr_SQA& sqa, const Params_SQA& p) {
+void printOrderSA (const Anlr_SA& sa, const Params_SA& p) {
+    const int w = std::lround(std::sqrt(sa.getLength())), h = sa.getHeight(), r = p.rank;
+    const std::string filename =
+        custom_format("op_%d_%d_%d_Ti%f_Tf%f_tau%d.tsv", r, w, h, p.init_t, p.final_t, p.tau);
+    writeOrder(filename, "T", sa.getOrderSamples());
+    return;
+}
+
+void printMeasureSA (const Measurement& m, const Anlr_SA& sa, const Params_SA& p) {
+    const int l = sa.getLength(), h = sa.getHeight(), r = p.rank;
+    std::ofstream outfile(custom_format("measure_%d_%d_%d_T%f.tsv", r, l, h, p.init_t),
+                          std::ios::out);
+    m.write(outfile);
+    return;
+}
+
+void printSQA (const Anlr_SQA& sqa, const Params_SQA& p, const std::vector<int64_t>& labels) {
     const int l = sqa.getLength(), h = sqa.getHeight(), t = p.tau, r = p.rank;
     const double ig = p.init_g, fg = p.final_g;
     std::ofstream outfile;
@@ -117,6 +155,13 @@ void printSQA (const Anlr_SQA& sqa, const Params_SQA& p) {
     outfile.open(filename, std::ios::out);
     sqa.printConfig(outfile);
     outfile.close();
+    // Print the best layer seen, in the format of printSAV2
+    const std::vector<Spin> best = sqa.getBestSpins();
+    filename = custom_format("conf_N%d_G%f_tau%d_%04d.dat", (int)best.size(), ig, t, r);
+    outfile.open(filename, std::ios::out);
+    outfile << std::setprecision(10) << sqa.getBestEnergy() << std::endl;
+    writeSpins(outfile, best, labels);
+    outfile.close();
     return;
 }
 
@@ -130,3 +175,112 @@ void printTriSQA (const Anlr_SQA& sqa, const Params_SQA& p) {
     tri::printTriConf(sqa.getSpins(), sqa.getLength(), outfile);
     outfile.close();
 }
+
+void printOrderSQA (const Anlr_SQA& sqa, const Params_SQA& p) {
+    const int w = std::lround(std::sqrt(sqa.getLength())), h = sqa.getHeight(), r = p.rank;
+    const std::string filename =
+        custom_format("op_%d_%d_%d_Gi%f_Gf%f_tau%d.tsv", r, w, h, p.init_g, p.final_g, p.tau);
+    writeOrder(filename, "gamma", sqa.getOrderSamples());
+    return;
+}
+
+void printMeasureSQA (const Measurement& m, const Anlr_SQA& sqa, const Params_SQA& p) {
+    const int l = sqa.getLength(), h = sqa.getHeight(), r = p.rank;
+    std::ofstream outfile(custom_format("measure_%d_%d_%d_G%f.tsv", r, l, h, p.init_g),
+                          std::ios::out);
+    m.write(outfile);
+    return;
+}
+
+void printTABU (const Anlr_TABU& tabu, const Params_TABU& p,
+                const std::vector<int64_t>& labels) {
+    const std::vector<Spin> spins = tabu.getSpins();
+    std::ofstream outfile;
+
+    std::string filename =
+        custom_format("conf_N%d_tabu_tau%d_%04d.dat", (int)spins.size(), p.tau, p.rank);
+    outfile.open(filename, std::ios::out);
+    outfile << std::setprecision(10) << tabu.getHamiltonianEnergy() << std::endl;
+    writeSpins(outfile, spins, labels);
+    outfile.close();
+    return;
+}
+
+void printTriTABU (const Anlr_TABU& tabu, const Params_TABU& p) {
+    std::ofstream outfile;
+
+    std::string filename =
+        custom_format("tri_%d_%d_tabu_tau%d.tsv", p.rank, tabu.getLength(), p.tau);
+    outfile.open(filename, std::ios::out);
+    tri::printTriConf(tabu.getSpins(), tabu.getLength(), outfile);
+    outfile.close();
+}
+
+void printPA (const Anlr_PA& pa, const Params_PA& p, const std::vector<int64_t>& labels) {
+    const std::vector<Spin> spins = pa.getSpins();
+    std::ofstream outfile;
+
+    std::string filename =
+        custom_format("conf_N%d_pa_T%f_tau%d_%04d.dat", (int)spins.size(), p.init_t, p.tau, p.rank);
+    outfile.open(filename, std::ios::out);
+    outfile << std::setprecision(10) << pa.getHamiltonianEnergy() << std::endl;
+    writeSpins(outfile, spins, labels);
+    outfile.close();
+
+    filename =
+        custom_format("pa_N%d_T%f_tau%d_%04d.tsv", (int)spins.size(), p.init_t, p.tau, p.rank);
+    outfile.open(filename, std::ios::out);
+    outfile << "step\tT\tfree_energy\tmean_energy\tmin_energy\tfamilies\n";
+    outfile << std::setprecision(10);
+    const std::vector<PopulationStep> history = pa.getHistory();
+    for (int i = 0; i < (int)history.size(); ++i) {
+        const PopulationStep& s = history[i];
+        outfile << i << "\t" << s.T << "\t" << s.free_energy << "\t" << s.mean_energy << "\t"
+                << s.min_energy << "\t" << s.families << std::endl;
+    }
+    outfile.close();
+    return;
+}
+
+void printTriPA (const Anlr_PA& pa, const Params_PA& p) {
+    std::ofstream outfile;
+
+    std::string filename = custom_format("tri_%d_%d_pa_T%f_tau%d.tsv", p.rank, pa.getLength(),
+                                         p.init_t, p.tau);
+    outfile.open(filename, std::ios::out);
+    tri::printTriConf(pa.getSpins(), pa.getLength(), outfile);
+    outfile.close();
+}
+
+void printWL (const Anlr_WL& wl, const Params_WL& p, const std::vector<int64_t>& labels) {
+    const std::vector<Spin> spins = wl.getSpins();
+    std::ofstream outfile(custom_format("conf_N%d_wl_%04d.dat", (int)spins.size(), p.rank),
+                          std::ios::out);
+    outfile << std::setprecision(10) << wl.getHamiltonianEnergy() << std::endl;
+    writeSpins(outfile, spins, labels);
+    return;
+}
+
+void printDensity (const Anlr_WL& wl, const Params_WL& p) {
+    const int n = wl.getSpins().size();
+    std::ofstream outfile(custom_format("wl_N%d_W%d_%04d.tsv", n, p.windows, p.rank),
+                          std::ios::out);
+    outfile << "energy\tln_g\n" << std::setprecision(10);
+    for (const DensityPoint& d : wl.getDensity())
+        outfile << d.energy << "\t" << d.ln_g << "\n";
+    return;
+}
+
+#ifdef USE_MPI
+void printPSA (const Anlr_PSA& psa, const Params_SA& p, const std::vector<int64_t>& labels) {
+    const double energy = psa.getHamiltonianEnergy(); // Collective, call on every rank
+    std::ofstream outfile;
+
+    std::string filename = custom_format("conf_N%d_T%f_tau%d_part%04d.dat", psa.getTotal(),
+                                         p.init_t, p.tau, p.rank);
+    outfile.open(filename, std::ios::out);
+    outfile << std::setprecision(10) << energy << std::endl;
+    psa.printConfig(outfile, labels);
+    outfile.close();
+}
+#endif
@@ -1,7 +1,11 @@
+#include "./algo/pa/pa.h"
+#include "./algo/psa/psa.h"
 #include "./algo/sa/sa.h"
 #include "./algo/sqa/sqa.h"
+#include "./algo/tabu/tabu.h"
+#include "./algo/wl/wl.h"
 
-std::string format(const std::string fmt_str, ...);
+std::string custom_format(const std::string fmt_str, ...);
 
 /*
  * --print-conf
@@ -10,11 +14,49 @@ std::string format(const std::string fmt_str, ...);
  *  Print to tri_<len>_<height>_Ti<init-t>_Tf<final-t>_tau<tau>.tsv <- Triangular lattice for
  * Simulated Annealing Print to tri_<len>_<height>_Gi<init-g>_Gf<final-g>_tau<tau>.tsv <- Triangular
  * lattice for Simulated Quantum Annealing
+ *
+ * --op-every
+ *  Print to op_<rank>_<width>_<height>_Ti<init-t>_Tf<final-t>_tau<tau>.tsv (Gi / Gf for SQA) the
+ *  sweep, temperature or gamma and squared order parameter (mean over the layers) of every sample
+ *
+ * --func wl
+ *  Print to wl_N<spins>_W<windows>_<rank>.tsv the energy and ln g(E) of every visited energy
+ *
+ * --measure
+ *  Print to measure_<rank>_<len>_<height>_T<init-t>.tsv (G<init-g> for SQA) the estimates of the
+ *  observables, their errors and autocorrelation times
+ *
+ * The conf_*.dat printers take the input ID of every spin (see IdMap and --reorder) and write the
+ * spins by input ID.
  */
 
-void printSAV2(const Anlr_SA&, const Params_SA&);
+void printSAV2(const Anlr_SA&, const Params_SA&,
+               const std::vector<int64_t>& = std::vector<int64_t>());
 void printSA(const Anlr_SA&, const Params_SA&);
 void printTriSA(const Anlr_SA&, const Params_SA&);
 
-void printSQA(const Anlr_SQA&, const Params_SQA&);
+void printOrderSA(const Anlr_SA&, const Params_SA&); // --op-every samples
+void printMeasureSA(const Measurement&, const Anlr_SA&, const Params_SA&);
+
+void printSQA(const Anlr_SQA&, const Params_SQA&,
+              const std::vector<int64_t>& = std::vector<int64_t>());
 void printTriSQA(const Anlr_SQA&, const Params_SQA&);
+void printOrderSQA(const Anlr_SQA&, const Params_SQA&);
+void printMeasureSQA(const Measurement&, const Anlr_SQA&, const Params_SQA&);
+
+void printTABU(const Anlr_TABU&, const Params_TABU&,
+               const std::vector<int64_t>& = std::vector<int64_t>());
+void printTriTABU(const Anlr_TABU&, const Params_TABU&);
+
+void printPA(const Anlr_PA&, const Params_PA&,
+             const std::vector<int64_t>& = std::vector<int64_t>()); // Best replica, step statistics
+void printTriPA(const Anlr_PA&, const Params_PA&);
+
+void printWL(const Anlr_WL&, const Params_WL&,
+             const std::vector<int64_t>& = std::vector<int64_t>()); // Lowest configuration
+void printDensity(const Anlr_WL&, const Params_WL&); // ln g(E), written without --print-conf too
+
+#ifdef USE_MPI
+void printPSA(const Anlr_PSA&, const Params_SA&,
+              const std::vector<int64_t>& = std::vector<int64_t>()); // Collective, file per rank
+#endif
@@ -0,0 +1,460 @@
+#include "serve.h"
+#include "../api/anneal.h"
+#include "../api/internal.h"
+#include "../graph/IdMap.h"
+#include "../run.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace serve {
+
+namespace {
+
+using SolverHandle = std::unique_ptr<anneal_solver, decltype(&anneal_solver_destroy)>;
+
+// A loaded input file, shared by the jobs that anneal it
+struct Instance {
+    anneal_graph *graph;
+    int spins;
+    IdMap ids; // Input ID of every spin
+
+    Instance (anneal_graph *g, IdMap i) : graph(g), spins(i.size()), ids(std::move(i)) {}
+    Instance (const Instance&)            = delete;
+    Instance& operator=(const Instance&) = delete;
+    ~Instance () { anneal_graph_destroy(this->graph); }
+};
+
+// A client, its replies are written whole by one thread at a time
+struct Connection {
+    int fd;
+    std::mutex write_lock;
+    std::atomic<bool> closed;
+
+    Connection (const int& f) : fd(f), closed(false) {}
+    ~Connection () { close(this->fd); }
+
+    void send (const std::string& line) {
+        std::lock_guard<std::mutex> lock(this->write_lock);
+        if (this->closed.load()) return;
+        const std::string data = line + "\n";
+        for (size_t sent = 0; sent < data.size();) {
+            const ssize_t n =
+                ::send(this->fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                this->closed.store(true); // The client went away, its jobs get cancelled
+                return;
+            }
+            sent += n;
+        }
+    }
+};
+
+struct Job {
+    long id;
+    std::shared_ptr<Connection> client;
+    std::shared_ptr<const Instance> instance;
+    SolverHandle solver;
+};
+
+// FNV-1a of the content of a file, the instance ID
+uint64_t contentHash (const std::string& content, const bool& qubo) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : content) {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+    hash ^= qubo ? 'q' : 'i'; // The same file read as QUBO is another instance
+    return hash * 1099511628211ULL;
+}
+
+std::string hexId (const uint64_t& hash) {
+    char id[17];
+    std::snprintf(id, sizeof(id), "%016llx", (unsigned long long)hash);
+    return id;
+}
+
+int engineOf (const std::string& name) {
+    if (name == "sa") return ANNEAL_SA;
+    if (name == "sqa") return ANNEAL_SQA;
+    if (name == "tabu") return ANNEAL_TABU;
+    if (name == "pa") return ANNEAL_PA;
+    throw std::invalid_argument("Unknown engine " + name + ", expected sa, sqa, tabu or pa");
+}
+
+class Server {
+  private:
+    std::mutex lock;
+    std::condition_variable ready;   // A job was queued, or the server stops
+    std::condition_variable leaving; // A client disconnected
+    std::unordered_map<std::string, std::shared_ptr<const Instance> > instances;
+    std::deque<std::shared_ptr<Job> > queue;
+    std::unordered_map<long, std::shared_ptr<Job> > running;
+    std::set<std::shared_ptr<Connection> > clients;
+    long next_job = 1;
+    bool stopping = false;
+
+    std::string path;
+    int listener;
+    int wake[2]; // Written once to stop the accept loop
+    int workers;
+
+    std::string load(std::istringstream&);
+    void solve(const std::shared_ptr<Connection>&, std::istringstream&); // Replies itself
+    std::string cancel(std::istringstream&);
+    std::string drop(std::istringstream&);
+    std::string stats();
+    std::string shutdown();
+
+    bool handle(const std::shared_ptr<Connection>&, const std::string&);
+    void read(std::shared_ptr<Connection>);
+    void disconnect(const std::shared_ptr<Connection>&);
+    void work();
+    void report(const Job&, const int&);
+
+  public:
+    Server(const std::string&, const int&);
+    ~Server();
+    void loop(); // Until a shutdown request
+};
+
+Server::Server (const std::string& p, const int& w) : path(p), workers(w) {
+    sockaddr_un address = {};
+    address.sun_family  = AF_UNIX;
+    if (this->path.size() >= sizeof(address.sun_path))
+        throw std::invalid_argument("--serve socket path is too long: " + this->path);
+    std::strcpy(address.sun_path, this->path.c_str());
+
+    struct stat info;
+    if (lstat(this->path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(this->path.c_str()); // Left over by a server that did not shut down
+    this->listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (this->listener < 0 || bind(this->listener, (sockaddr *)&address, sizeof(address)) != 0 ||
+        listen(this->listener, SOMAXCONN) != 0 || pipe(this->wake) != 0)
+        throw std::runtime_error("Cannot listen on " + this->path + ": " + std::strerror(errno));
+    return;
+}
+
+Server::~Server () {
+    close(this->listener);
+    close(this->wake[0]);
+    close(this->wake[1]);
+    unlink(this->path.c_str());
+}
+
+void Server::loop () {
+    std::vector<std::thread> pool;
+    for (int w = 0; w < this->workers; ++w)
+        pool.emplace_back([this] () { this->work(); });
+    std::cout << "Serving on " << this->path << " with " << this->workers << " workers"
+              << std::endl;
+
+    pollfd watched[2] = { { this->listener, POLLIN, 0 }, { this->wake[0], POLLIN, 0 } };
+    while (true) {
+        if (poll(watched, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+        if (watched[1].revents) break;
+        const int fd = accept(this->listener, nullptr, nullptr);
+        if (fd < 0) continue;
+        std::shared_ptr<Connection> client = std::make_shared<Connection>(fd);
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->clients.insert(client);
+        }
+        std::thread([this, client] () { this->read(client); }).detach();
+    }
+
+    for (std::thread& t : pool)
+        t.join();
+    std::unique_lock<std::mutex> guard(this->lock);
+    for (const std::shared_ptr<Connection>& client : this->clients)
+        ::shutdown(client->fd, SHUT_RDWR); // Wakes the readers
+    this->leaving.wait(guard, [this] () { return this->clients.empty(); });
+    return;
+}
+
+// Lines of a client until it quits or goes away
+void Server::read (std::shared_ptr<Connection> client) {
+    std::string pending;
+    char buffer[4096];
+    for (bool open = true; open;) {
+        const ssize_t n = recv(client->fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        pending.append(buffer, n);
+        size_t start = 0;
+        for (size_t end; open && (end = pending.find('\n', start)) != std::string::npos;
+             start = end + 1)
+            open = this->handle(client, pending.substr(start, end - start));
+        pending.erase(0, start);
+    }
+    this->disconnect(client);
+    return;
+}
+
+// Answer a request line, false once the connection should close
+bool Server::handle (const std::shared_ptr<Connection>& client, const std::string& line) {
+    std::istringstream words(line);
+    std::string command;
+    if (!(words >> command)) return true; // Blank line
+    try {
+        if (command == "load") client->send(this->load(words));
+        else if (command == "solve") this->solve(client, words);
+        else if (command == "cancel") client->send(this->cancel(words));
+        else if (command == "drop") client->send(this->drop(words));
+        else if (command == "stats") client->send(this->stats());
+        else if (command == "quit") return false;
+        else if (command == "shutdown") {
+            client->send(this->shutdown());
+            return false;
+        } else throw std::invalid_argument("Unknown request " + command);
+    } catch (const std::exception& e) {
+        client->send(std::string("error ") + e.what());
+    }
+    return true;
+}
+
+std::string Server::load (std::istringstream& words) {
+    std::string file, mode;
+    if (!(words >> file)) throw std::invalid_argument("load <file> [qubo]");
+    words >> mode;
+    if (!mode.empty() && mode != "qubo") throw std::invalid_argument("Unknown load mode " + mode);
+    const bool qubo = mode == "qubo";
+
+    std::fstream source(file, std::ios::in);
+    if (!source.is_open()) throw std::invalid_argument("Cannot open " + file);
+    std::stringstream content;
+    content << source.rdbuf();
+    const std::string id = hexId(contentHash(content.str(), qubo));
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::unordered_map<std::string, std::shared_ptr<const Instance> >::const_iterator it =
+            this->instances.find(id);
+        if (it != this->instances.end())
+            return "ok " + id + " " + std::to_string(it->second->spins);
+    }
+
+    // Parsed outside of the lock, a client loading the same file at once parses it twice
+    source.clear();
+    source.seekg(0);
+    IdMap ids;
+    Graph graph = qubo ? readInputFromQubo(source, ids) : readInput(source, ids);
+    graph.lockLength();
+    anneal_graph *handle = annealGraph(graph);
+    if (handle == nullptr) throw std::invalid_argument(anneal_last_error());
+    std::shared_ptr<const Instance> instance = std::make_shared<Instance>(handle, std::move(ids));
+
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->instances.emplace(id, instance);
+    return "ok " + id + " " + std::to_string(instance->spins);
+}
+
+void Server::solve (const std::shared_ptr<Connection>& client, std::istringstream& words) {
+    std::string id, engine;
+    if (!(words >> id >> engine))
+        throw std::invalid_argument("solve <instance> <engine> [key=value ...]");
+    SolverHandle solver(anneal_solver_create(engineOf(engine)), &anneal_solver_destroy);
+    for (std::string option; words >> option;) {
+        const size_t equal = option.find('=');
+        if (equal == std::string::npos)
+            throw std::invalid_argument("Expected key=value: " + option);
+        if (annealSetOption(solver.get(), option.substr(0, equal), option.substr(equal + 1)) !=
+            ANNEAL_OK)
+            throw std::invalid_argument(anneal_last_error());
+    }
+
+    std::shared_ptr<Job> job;
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->stopping) throw std::runtime_error("The server is shutting down");
+        std::unordered_map<std::string, std::shared_ptr<const Instance> >::const_iterator it =
+            this->instances.find(id);
+        if (it == this->instances.end()) throw std::invalid_argument("Unknown instance " + id);
+        job.reset(new Job { this->next_job++, client, it->second, std::move(solver) });
+    }
+    // Answered before a worker can take the job, so queued comes before its result and done lines
+    client->send("queued " + std::to_string(job->id));
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (!this->stopping) {
+            this->queue.push_back(job);
+            this->ready.notify_one();
+            return;
+        }
+    }
+    client->send("done " + std::to_string(job->id) + " cancelled"); // Shut down meanwhile
+    return;
+}
+
+std::string Server::cancel (std::istringstream& words) {
+    long id;
+    if (!(words >> id)) throw std::invalid_argument("cancel <job>");
+    std::shared_ptr<Job> queued;
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        std::unordered_map<long, std::shared_ptr<Job> >::iterator it = this->running.find(id);
+        if (it != this->running.end()) {
+            anneal_cancel(it->second->solver.get()); // Its worker reports it
+            return "ok";
+        }
+        std::deque<std::shared_ptr<Job> >::iterator q =
+            std::find_if(this->queue.begin(), this->queue.end(),
+                         [&] (const std::shared_ptr<Job>& job) { return job->id == id; });
+        if (q == this->queue.end()) throw std::invalid_argument("No job " + std::to_string(id));
+        queued = *q;
+        this->queue.erase(q);
+    }
+    queued->client->send("done " + std::to_string(id) + " cancelled");
+    return "ok";
+}
+
+std::string Server::drop (std::istringstream& words) {
+    std::string id;
+    if (!(words >> id)) throw std::invalid_argument("drop <instance>");
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (this->instances.erase(id) == 0) throw std::invalid_argument("Unknown instance " + id);
+    return "ok";
+}
+
+std::string Server::stats () {
+    std::lock_guard<std::mutex> guard(this->lock);
+    return "stats instances " + std::to_string(this->instances.size()) + " queued " +
+           std::to_string(this->queue.size()) + " running " +
+           std::to_string(this->running.size()) + " workers " + std::to_string(this->workers);
+}
+
+// Cancel every job and wake the accept loop and the workers
+std::string Server::shutdown () {
+    std::deque<std::shared_ptr<Job> > queued;
+    {
+        std::lock_guard<std::mutex> guard(this->lock);
+        if (this->stopping) return "ok";
+        this->stopping = true;
+        queued.swap(this->queue);
+        for (std::pair<const long, std::shared_ptr<Job> >& job : this->running)
+            anneal_cancel(job.second->solver.get());
+        this->ready.notify_all();
+    }
+    for (const std::shared_ptr<Job>& job : queued)
+        job->client->send("done " + std::to_string(job->id) + " cancelled");
+    if (write(this->wake[1], "", 1) != 1)
+        throw std::runtime_error(std::string("Cannot stop the server: ") + std::strerror(errno));
+    return "ok";
+}
+
+// Forget a client, its jobs are cancelled
+void Server::disconnect (const std::shared_ptr<Connection>& client) {
+    ::shutdown(client->fd, SHUT_RDWR);
+    std::lock_guard<std::mutex> guard(this->lock);
+    client->closed.store(true);
+    for (std::pair<const long, std::shared_ptr<Job> >& job : this->running)
+        if (job.second->client == client) anneal_cancel(job.second->solver.get());
+    this->queue.erase(std::remove_if(this->queue.begin(), this->queue.end(),
+                                     [&] (const std::shared_ptr<Job>& job) {
+                                         return job->client == client;
+                                     }),
+                      this->queue.end());
+    this->clients.erase(client);
+    this->leaving.notify_all();
+    return;
+}
+
+void onResult (void *user, int replica, double energy) {
+    const Job *job = (const Job *)user;
+    std::ostringstream line;
+    line << std::setprecision(10) << "result " << job->id << " " << replica << " " << energy;
+    job->client->send(line.str());
+    return;
+}
+
+// Anneal the queued jobs one after another until the server stops
+void Server::work () {
+    while (true) {
+        std::shared_ptr<Job> job;
+        std::string failure;
+        {
+            std::unique_lock<std::mutex> guard(this->lock);
+            this->ready.wait(guard, [this] () { return this->stopping || !this->queue.empty(); });
+            if (this->queue.empty()) return;
+            job = this->queue.front();
+            this->queue.pop_front();
+            // Started under the lock, so a cancel finds it running or still queued
+            anneal_solver_set_callback(job->solver.get(), onResult, job.get());
+            if (anneal_solve_async(job->solver.get(), job->instance->graph) == ANNEAL_OK)
+                this->running.emplace(job->id, job);
+            else failure = "done " + std::to_string(job->id) + " failed " + anneal_last_error();
+        }
+        if (!failure.empty()) { // Sent without the lock, a slow client holds up its own jobs only
+            job->client->send(failure);
+            continue;
+        }
+        const int status = anneal_wait(job->solver.get());
+        {
+            std::lock_guard<std::mutex> guard(this->lock);
+            this->running.erase(job->id);
+        }
+        this->report(*job, status);
+    }
+}
+
+void Server::report (const Job& job, const int& status) {
+    std::ostringstream line;
+    line << std::setprecision(10) << "done " << job.id;
+    if (status != ANNEAL_OK && status != ANNEAL_CANCELLED) {
+        line << " failed " << anneal_last_error();
+        job.client->send(line.str());
+        return;
+    }
+    line << (status == ANNEAL_OK ? " ok" : " cancelled");
+    double energy;
+    if (anneal_result_energy(job.solver.get(), 0, &energy) == ANNEAL_OK) {
+        std::vector<int8_t> spins(job.instance->spins);
+        anneal_result_spins(job.solver.get(), 0, spins.data(), spins.size());
+        line << " " << energy;
+        for (int i = 0; i < job.instance->spins; ++i) // Dense indices follow the input IDs
+            line << " " << job.instance->ids.id(i) << " " << (int)spins[i];
+    }
+    job.client->send(line.str());
+    return;
+}
+
+} // namespace
+
+int run (const CustomArgs& args) {
+    const std::string path = std::get<std::string>(args.getArg("--serve"));
+    const int workers      = args.hasArg("--workers")
+                                 ? std::get<int>(args.getArg("--workers"))
+                                 : std::max(1, (int)std::thread::hardware_concurrency());
+    Server server(path, workers);
+    server.loop();
+    return 0;
+}
+
+} // namespace serve
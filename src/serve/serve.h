@@ -0,0 +1,33 @@
+#ifndef _SERVE_H_
+#define _SERVE_H_
+
+#include "../args/Args.h"
+
+/*
+ * Server mode (--serve <socket>): instances are loaded once and kept by the hash of their
+ * content, annealing jobs on them are queued onto a pool of --workers threads, and the results
+ * are streamed back to the client that asked for them. The protocol is one line of text per
+ * request or reply over a unix stream socket:
+ *
+ *   load <file> [qubo]              ok <instance> <spins>
+ *   solve <instance> <engine> [key=value ...]
+ *                                   queued <job>, then result <job> <replica> <energy> as the
+ *                                   replicas finish and done <job> <ok|cancelled> [<energy>
+ *                                   <id spin ...>] or done <job> failed <message>
+ *   cancel <job>                    ok
+ *   drop <instance>                 ok, the jobs already queued keep the instance
+ *   stats                           stats instances <n> queued <n> running <n> workers <n>
+ *   quit                            closes the connection, its jobs are cancelled
+ *   shutdown                        ok, cancels every job and stops the server
+ *
+ * A failed request is answered with error <message>. The engine is sa, sqa, tabu or pa and the
+ * keys are the solver options of the C interface (src/api/anneal.h). The spins of done are the
+ * best replica, pairs of an input ID and its spin (-1 or 1) in increasing order of the IDs.
+ */
+namespace serve {
+
+int run(const CustomArgs&); // Answer the clients of the socket until a shutdown request
+
+} // namespace serve
+
+#endif